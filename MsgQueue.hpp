@@ -13,9 +13,26 @@
 // limitations under the License.
 
 #pragma once
+#include <chrono>
+#include <concepts>
+#include <cstddef>
+#include <exception>
+#include <limits>
 #include <memory>
+#include <new>
+#include <span>
+#include <stop_token>
+#include <thread>
+#include <tuple>
+#include <type_traits>
 #include <utility>
 
+#include "backend/CacheLine.hpp"
+
+// Backend capabilities. ValidBackend is all a backend has to provide, every other
+// concept refines it with an optional feature that MsgQueue and BasicMsgQueue use when
+// it is there and replace with a generic fallback when it is not.
+
 // concept for a message queue
 template <typename T>
 concept ValidBackend = requires(T t) {
@@ -25,28 +42,367 @@ concept ValidBackend = requires(T t) {
   { t.size() } -> std::same_as<size_t>;
 };
 
+// a backend that moves a whole burst per call and publishes its index once
+template <typename T>
+concept BulkBackend = ValidBackend<T> && requires(T t, typename T::BufferElement* p, size_t n) {
+  { t.push_n(std::span<typename T::BufferElement>(p, n)) } -> std::same_as<size_t>;
+  { t.push_n(std::span<const typename T::BufferElement>(p, n)) } -> std::same_as<size_t>;
+  { t.try_pop_n(std::span<typename T::BufferElement>(p, n)) } -> std::same_as<size_t>;
+};
+
+// a backend whose pop() blocks until a message arrives, so a consumer can sleep
+template <typename T>
+concept BlockingBackend = ValidBackend<T> && requires(T t) {
+  { t.pop() } -> std::convertible_to<typename T::BufferElement>;
+};
+
+// a blocking backend that can also give up at a deadline or on a stop request,
+// returning an empty optional-like result in that case
+template <typename T>
+concept TimedBackend
+    = BlockingBackend<T>
+      && requires(T t, std::chrono::steady_clock::time_point deadline, std::stop_token stop) {
+           { static_cast<bool>(t.pop_until(deadline)) };
+           { *t.pop_until(deadline) } -> std::convertible_to<typename T::BufferElement>;
+           { static_cast<bool>(t.pop(stop)) };
+           { *t.pop(stop) } -> std::convertible_to<typename T::BufferElement>;
+         };
+
+// a backend that hands out its slots, so messages are written and read in place
+template <typename T>
+concept ZeroCopyBackend = ValidBackend<T> && requires(T t, size_t n) {
+  { t.reserve(n) } -> std::same_as<std::span<typename T::BufferElement>>;
+  t.commit(n);
+  { t.peek(n) } -> std::same_as<std::span<const typename T::BufferElement>>;
+  t.release(n);
+};
+
+// a backend that many threads may push to at once, it says so with
+// static constexpr bool kMultiProducer = true
+template <typename T>
+concept MultiProducerBackend = ValidBackend<T> && requires { requires T::kMultiProducer; };
+
+// a backend that many threads may pop from at once, it says so with
+// static constexpr bool kMultiConsumer = true
+template <typename T>
+concept MultiConsumerBackend = ValidBackend<T> && requires { requires T::kMultiConsumer; };
+
+// a backend that holds at most capacity() messages
+template <typename T>
+concept BoundedBackend = ValidBackend<T> && requires(const T t) {
+  { t.capacity() } -> std::convertible_to<size_t>;
+};
+
+// which of the concepts above a backend models, for code behind the type erasure
+struct BackendFeatures {
+  bool bulk;
+  bool blocking;
+  bool timed;
+  bool zero_copy;
+  bool multi_producer;
+  bool multi_consumer;
+  bool bounded;
+};
+
+template <typename T>
+inline constexpr BackendFeatures kBackendFeatures{
+    .bulk           = BulkBackend<T>,
+    .blocking       = BlockingBackend<T>,
+    .timed          = TimedBackend<T>,
+    .zero_copy      = ZeroCopyBackend<T>,
+    .multi_producer = MultiProducerBackend<T>,
+    .multi_consumer = MultiConsumerBackend<T>,
+    .bounded        = BoundedBackend<T>,
+};
+
+// Statically typed message queue: the same surface as MsgQueue, but the backend is
+// part of the type, so every call inlines down to the backend. Use MsgQueue where the
+// backend has to be hidden. Unlike MsgQueue the message type is checked.
+//
+// Blocking and timed dequeues sleep in the backend when it is a BlockingBackend or a
+// TimedBackend and fall back to polling try_pop() otherwise.
+template <ValidBackend Backend>
+class BasicMsgQueue {
+public:
+  using MessageType = typename Backend::BufferElement;
+
+  explicit BasicMsgQueue(Backend&& m) : instance(std::move(m)) {}
+
+  BasicMsgQueue(BasicMsgQueue&&)            = default;
+  BasicMsgQueue& operator=(BasicMsgQueue&&) = default;
+
+  BasicMsgQueue(const BasicMsgQueue&)            = delete;
+  BasicMsgQueue& operator=(const BasicMsgQueue&) = delete;
+
+  template <typename U>
+  void enqueue(U&& m) {
+    instance.push(std::forward<U>(m));
+  }
+
+  // constructs a message from args directly in the backend's slot if it supports that
+  template <typename T = MessageType, typename... Args>
+  void emplace(Args&&... args) {
+    static_assert(std::is_same_v<T, MessageType>, "emplace<T>: T is not the message type");
+    if constexpr (requires { instance.emplace(std::forward<Args>(args)...); }) {
+      instance.emplace(std::forward<Args>(args)...);
+    } else {
+      instance.push(MessageType(std::forward<Args>(args)...));
+    }
+  }
+
+  // Enqueues as many of ms as the backend takes without overwriting or blocking and
+  // returns that count. Elements of a non-const span are moved from. Backends without
+  // push_n() get one push per element, and all of ms if they lack try_push() too.
+  template <typename U>
+    requires std::is_same_v<std::remove_const_t<U>, MessageType>
+  size_t enqueue_n(std::span<U> ms) {
+    if constexpr (BulkBackend<Backend>) {
+      return instance.push_n(ms);
+    } else {
+      for (size_t i = 0; i < ms.size(); ++i) {
+        auto&& m = forward_element<U>(ms[i]);
+        if constexpr (requires { instance.try_push(m); }) {
+          if (!instance.try_push(std::forward<decltype(m)>(m))) {
+            return i;
+          }
+        } else {
+          instance.push(std::forward<decltype(m)>(m));
+        }
+      }
+      return ms.size();
+    }
+  }
+
+  bool dequeue(MessageType& m) { return instance.try_pop(m); }
+
+  // dequeues up to out.size() messages and returns that count
+  size_t dequeue_n(std::span<MessageType> out) {
+    if constexpr (BulkBackend<Backend>) {
+      return instance.try_pop_n(out);
+    } else {
+      size_t n = 0;
+      while (n < out.size() && instance.try_pop(out[n])) {
+        ++n;
+      }
+      return n;
+    }
+  }
+
+  // Calls f(MessageType&) on up to max messages, oldest first, and returns that count.
+  // Without a native drain the messages are popped one by one, into a default
+  // constructed message or else through a pop_until() that has already timed out.
+  template <typename T = MessageType, typename F>
+    requires requires(Backend b, size_t max) { b.drain(std::declval<F&>(), max); }
+             || std::default_initializable<MessageType> || TimedBackend<Backend>
+  size_t drain(F&& f, size_t max = std::numeric_limits<size_t>::max()) {
+    static_assert(std::is_same_v<T, MessageType>, "drain<T>: T is not the message type");
+    if constexpr (requires { instance.drain(f, max); }) {
+      return instance.drain(f, max);
+    } else if constexpr (std::default_initializable<MessageType>) {
+      MessageType m;
+      size_t n = 0;
+      while (n < max && instance.try_pop(m)) {
+        f(m);
+        ++n;
+      }
+      return n;
+    } else {
+      size_t n = 0;
+      for (; n < max; ++n) {
+        auto m = instance.pop_until(std::chrono::steady_clock::time_point::min());
+        if (!m) {
+          break;
+        }
+        f(*m);
+      }
+      return n;
+    }
+  }
+
+  // blocks until a message arrives, idling the way the backend's wait strategy says
+  void dequeue_wait(MessageType& m) {
+    if constexpr (BlockingBackend<Backend>) {
+      m = instance.pop();
+    } else {
+      while (!instance.try_pop(m)) {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  // blocks until a message arrives or stop is requested, false in the latter case
+  bool dequeue_wait(MessageType& m, std::stop_token stop) {
+    if constexpr (TimedBackend<Backend>) {
+      return assign(m, instance.pop(stop));
+    } else {
+      while (!instance.try_pop(m)) {
+        if (stop.stop_requested()) {
+          return false;
+        }
+        std::this_thread::yield();
+      }
+      return true;
+    }
+  }
+
+  // blocks for at most timeout, false if no message arrived
+  template <typename Rep, typename Period>
+  bool dequeue_for(MessageType& m, const std::chrono::duration<Rep, Period>& timeout) {
+    return dequeue_until(m, std::chrono::steady_clock::now()
+                                + std::chrono::ceil<std::chrono::steady_clock::duration>(timeout));
+  }
+
+  // blocks until deadline at the latest, false if no message arrived
+  template <typename Clock, typename Duration>
+  bool dequeue_until(MessageType& m, const std::chrono::time_point<Clock, Duration>& deadline) {
+    if constexpr (!std::is_same_v<Clock, std::chrono::steady_clock>) {
+      return dequeue_for(m, deadline - Clock::now());
+    } else if constexpr (TimedBackend<Backend>) {
+      return assign(m, instance.pop_until(deadline));
+    } else {
+      while (!instance.try_pop(m)) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+          return false;
+        }
+        std::this_thread::yield();
+      }
+      return true;
+    }
+  }
+
+  // Zero-copy producer side, only for a ZeroCopyBackend: up to n slots to write
+  // messages into, the first k of which are published with commit(k)
+  template <typename T = MessageType>
+    requires ZeroCopyBackend<Backend>
+  std::span<MessageType> reserve(size_t n = 1) {
+    static_assert(std::is_same_v<T, MessageType>, "reserve<T>: T is not the message type");
+    return instance.reserve(n);
+  }
+
+  void commit(size_t n = 1)
+    requires ZeroCopyBackend<Backend>
+  {
+    instance.commit(n);
+  }
+
+  // Zero-copy consumer side, only for a ZeroCopyBackend: up to n messages to read in
+  // place, the first k of which are handed back with release(k)
+  template <typename T = MessageType>
+    requires ZeroCopyBackend<Backend>
+  std::span<const MessageType> peek(size_t n = 1) {
+    static_assert(std::is_same_v<T, MessageType>, "peek<T>: T is not the message type");
+    return instance.peek(n);
+  }
+
+  void release(size_t n = 1)
+    requires ZeroCopyBackend<Backend>
+  {
+    instance.release(n);
+  }
+
+  bool empty() const { return instance.empty(); }
+
+  size_t size() const { return instance.size(); }
+
+  // the most messages the backend holds, the maximum size_t if it is unbounded
+  size_t capacity() const {
+    if constexpr (BoundedBackend<Backend>) {
+      return instance.capacity();
+    } else {
+      return std::numeric_limits<size_t>::max();
+    }
+  }
+
+  static constexpr BackendFeatures features() { return kBackendFeatures<Backend>; }
+
+private:
+  // an element of a std::span<U>, as an rvalue unless U is const
+  template <typename U>
+  static decltype(auto) forward_element(U& m) {
+    if constexpr (std::is_const_v<U>) {
+      return static_cast<const MessageType&>(m);
+    } else {
+      return static_cast<MessageType&&>(m);
+    }
+  }
+
+  template <typename Optional>
+  static bool assign(MessageType& out, Optional&& item) {
+    if (!item) {
+      return false;
+    }
+    out = std::move(*item);
+    return true;
+  }
+
+  Backend instance;  // the actual queue
+};
+
+// room for the vtable pointer and a RingBuffer behind it
+inline constexpr size_t kMsgQueueInlineSize = 5 * kCacheLineSize;
+
 // External Polymorphism
-class MsgQueue {
+//
+// Backends of up to InlineSize bytes are stored inside the queue object, so creating
+// a queue does not allocate and the vtable pointer sits next to the backend's indices.
+// Larger backends (e.g. StaticRingBuffer), and ones whose move may throw, go to the heap.
+template <size_t InlineSize>
+class SizedMsgQueue {
 public:
   template <ValidBackend T>
-  MsgQueue(T&& m) : pimpl(std::make_unique<backend<T>>(std::forward<T>(m))) {}
+  SizedMsgQueue(T&& m) {
+    if constexpr (fits_inline<T>) {
+      pimpl   = ::new (static_cast<void*>(buffer)) backend<T>(std::forward<T>(m));
+      inlined = true;
+    } else {
+      pimpl = new backend<T>(std::forward<T>(m));
+    }
+  }
 
-  MsgQueue(MsgQueue&& m) : pimpl(std::move(m.pimpl)){};
+  SizedMsgQueue(SizedMsgQueue&& m) noexcept { take(m); }
 
-  MsgQueue& operator=(MsgQueue&& m) {
-    pimpl = std::move(m.pimpl);
+  SizedMsgQueue& operator=(SizedMsgQueue&& m) noexcept {
+    if (this != &m) {
+      reset();
+      take(m);
+    }
     return *this;
   }
 
   // delete copy constructor
-  MsgQueue(const MsgQueue&)            = delete;
-  MsgQueue& operator=(const MsgQueue&) = delete;
+  SizedMsgQueue(const SizedMsgQueue&)            = delete;
+  SizedMsgQueue& operator=(const SizedMsgQueue&) = delete;
 
-  ~MsgQueue() = default;
+  ~SizedMsgQueue() { reset(); }
 
+  // an rvalue is moved into the backend, an lvalue is copied
   template <typename U>
   void enqueue(U&& m) {
-    pimpl->push(static_cast<void*>(&m));
+    if constexpr (std::is_lvalue_reference_v<U> || std::is_const_v<std::remove_reference_t<U>>) {
+      pimpl->push_copy(static_cast<const void*>(&m));
+    } else {
+      pimpl->push_move(static_cast<void*>(&m));
+    }
+  }
+
+  // constructs a T from args directly in the backend's slot, T has to be the
+  // backend's element type (unchecked, like enqueue)
+  template <typename T, typename... Args>
+  void emplace(Args&&... args) {
+    std::tuple<Args&&...> packed(std::forward<Args>(args)...);
+    pimpl->emplace(factory_t{reinterpret_cast<void (*)()>(&make<T, Args...>), &packed});
+  }
+
+  // Enqueues as many of ms as the backend takes without overwriting and returns that
+  // count, the whole burst costs one virtual call. Elements of a non-const span are
+  // moved from.
+  template <typename U>
+  size_t enqueue_n(std::span<U> ms) {
+    if constexpr (std::is_const_v<U>) {
+      return pimpl->push_n_copy(static_cast<const void*>(ms.data()), ms.size());
+    } else {
+      return pimpl->push_n_move(static_cast<void*>(ms.data()), ms.size());
+    }
   }
 
   template <typename U>
@@ -54,49 +410,308 @@ public:
     return pimpl->try_pop(static_cast<void*>(&m));
   }
 
+  // dequeues up to out.size() messages with one virtual call and returns that count
+  template <typename U>
+  size_t dequeue_n(std::span<U> out) {
+    return pimpl->try_pop_n(static_cast<void*>(out.data()), out.size());
+  }
+
+  // Calls f(T&) on up to max messages, oldest first, and returns that count. T has to
+  // be the backend's element type (unchecked, like dequeue). A T that is not default
+  // constructible needs a backend that drains natively or is a TimedBackend, anything
+  // else has nothing to pop into and terminates, like BasicMsgQueue fails to compile.
+  template <typename T, typename F>
+  size_t drain(F&& f, size_t max = std::numeric_limits<size_t>::max()) {
+    using Fn   = std::remove_reference_t<F>;
+    auto visit = [](void* ctx, void* m) { (*static_cast<Fn*>(ctx))(*static_cast<T*>(m)); };
+    return pimpl->drain(visit, const_cast<void*>(static_cast<const void*>(std::addressof(f))), max);
+  }
+
+  // blocks until a message arrives, idling the way the backend's wait strategy says
+  template <typename U>
+  void dequeue_wait(U& m) {
+    pimpl->pop(static_cast<void*>(&m));
+  }
+
+  // blocks until a message arrives or stop is requested, false in the latter case
+  template <typename U>
+  bool dequeue_wait(U& m, std::stop_token stop) {
+    return pimpl->pop(static_cast<void*>(&m), stop);
+  }
+
+  // blocks for at most timeout, false if no message arrived
+  template <typename U, typename Rep, typename Period>
+  bool dequeue_for(U& m, const std::chrono::duration<Rep, Period>& timeout) {
+    return pimpl->pop_until(
+        static_cast<void*>(&m),
+        std::chrono::steady_clock::now()
+            + std::chrono::ceil<std::chrono::steady_clock::duration>(timeout));
+  }
+
+  // blocks until deadline at the latest, false if no message arrived
+  template <typename U, typename Clock, typename Duration>
+  bool dequeue_until(U& m, const std::chrono::time_point<Clock, Duration>& deadline) {
+    if constexpr (std::is_same_v<Clock, std::chrono::steady_clock>) {
+      return pimpl->pop_until(static_cast<void*>(&m),
+                              std::chrono::ceil<std::chrono::steady_clock::duration>(deadline));
+    } else {
+      return dequeue_for(m, deadline - Clock::now());
+    }
+  }
+
+  // Zero-copy producer side: up to n slots to write T's into, the first k of which are
+  // published with commit(k). Always empty unless features().zero_copy, where commit()
+  // does nothing either.
+  template <typename T>
+  std::span<T> reserve(size_t n = 1) {
+    auto [slots, k] = pimpl->reserve(n);
+    return {static_cast<T*>(slots), k};
+  }
+
+  void commit(size_t n = 1) { pimpl->commit(n); }
+
+  // Zero-copy consumer side: up to n T's to read in place, the first k of which are
+  // handed back with release(k). Always empty unless features().zero_copy.
+  template <typename T>
+  std::span<const T> peek(size_t n = 1) {
+    auto [items, k] = pimpl->peek(n);
+    return {static_cast<const T*>(items), k};
+  }
+
+  void release(size_t n = 1) { pimpl->release(n); }
+
   bool empty() const { return pimpl->empty(); }
 
   size_t size() const { return pimpl->size(); }
 
+  // the most messages the backend holds, the maximum size_t if it is unbounded
+  size_t capacity() const { return pimpl->capacity(); }
+
+  // what the backend behind the erasure can do, e.g. whether it takes several producers
+  BackendFeatures features() const { return pimpl->features(); }
+
 private:
+  // builds the message out of the arguments packed by emplace(), make is really a
+  // T (*)(void*) for the backend's element type T
+  struct factory_t {
+    void (*make)();
+    void* args;
+  };
+
+  template <typename T, typename... Args>
+  static T make(void* args) {
+    return std::make_from_tuple<T>(std::move(*static_cast<std::tuple<Args&&...>*>(args)));
+  }
+
   struct concept_t {
     // virtual destructor
     virtual ~concept_t() = default;
-    // enqueue a message
-    virtual void push(void* in) = 0;
+    // move into the inline buffer dst of another queue
+    virtual concept_t* move_to(void* dst) noexcept = 0;
+    // enqueue a copy of a message
+    virtual void push_copy(const void* in) = 0;
+    // enqueue a message, moving from it
+    virtual void push_move(void* in) = 0;
+    // construct a message in place
+    virtual void emplace(factory_t factory) = 0;
+    // enqueue copies of up to n messages
+    virtual size_t push_n_copy(const void* in, size_t n) = 0;
+    // enqueue up to n messages, moving from them
+    virtual size_t push_n_move(void* in, size_t n) = 0;
     // dequeue a message
     virtual bool try_pop(void* out) = 0;
+    // dequeue up to n messages
+    virtual size_t try_pop_n(void* out, size_t n) = 0;
+    // hand up to max messages to visit(ctx, message)
+    virtual size_t drain(void (*visit)(void*, void*), void* ctx, size_t max) = 0;
+    // dequeue a message, block if there is none
+    virtual void pop(void* out) = 0;
+    // dequeue a message, block until one arrives or stop is requested
+    virtual bool pop(void* out, const std::stop_token& stop) = 0;
+    // dequeue a message, block until one arrives or deadline passes
+    virtual bool pop_until(void* out, std::chrono::steady_clock::time_point deadline) = 0;
+    // slots to write messages into, nothing if the backend is not zero-copy
+    virtual std::pair<void*, size_t> reserve(size_t n) = 0;
+    // publish n reserved slots
+    virtual void commit(size_t n) = 0;
+    // messages to read in place, nothing if the backend is not zero-copy
+    virtual std::pair<const void*, size_t> peek(size_t n) = 0;
+    // hand n peeked messages back
+    virtual void release(size_t n) = 0;
     // check if the queue is empty
     virtual bool empty() const = 0;
     // get the size of the queue
     virtual size_t size() const = 0;
+    // get the capacity of the queue
+    virtual size_t capacity() const = 0;
+    // get the capabilities of the backend
+    virtual BackendFeatures features() const = 0;
   };
 
   template <typename T>
   struct backend final : concept_t {
   public:
     using MessageType = typename std::decay_t<T>::BufferElement;
-    backend(T&& m) : instance(std::move(m)) {}
+    backend(T&& m) : queue(std::move(m)) {}
+
+    backend(backend&&) = default;
+
+    concept_t* move_to(void* dst) noexcept override {
+      if constexpr (fits_inline<T>) {
+        return ::new (dst) backend(std::move(*this));
+      } else {
+        std::terminate();  // heap backends are handed over by pointer
+      }
+    }
 
-    void push(void* in) override {
+    void push_copy(const void* in) override {
+      if constexpr (std::is_copy_constructible_v<MessageType>) {
+        const MessageType* typed_in = static_cast<const MessageType*>(in);
+        queue.enqueue(*typed_in);
+      } else {
+        std::terminate();  // enqueue() of an lvalue, but the message is move-only
+      }
+    }
+
+    void push_move(void* in) override {
       MessageType* typed_in = static_cast<MessageType*>(in);
-      instance.push(*typed_in);
-      return;
+      queue.enqueue(std::move(*typed_in));
+    }
+
+    void emplace(factory_t factory) override { queue.emplace(deferred{factory}); }
+
+    size_t push_n_copy(const void* in, size_t n) override {
+      if constexpr (std::is_copy_constructible_v<MessageType>) {
+        const MessageType* typed_in = static_cast<const MessageType*>(in);
+        return queue.enqueue_n(std::span<const MessageType>(typed_in, n));
+      } else {
+        std::terminate();  // enqueue_n() of a const span, but the message is move-only
+      }
+    }
+
+    size_t push_n_move(void* in, size_t n) override {
+      MessageType* typed_in = static_cast<MessageType*>(in);
+      return queue.enqueue_n(std::span<MessageType>(typed_in, n));
     }
 
     bool try_pop(void* out) override {
       MessageType* typed_out = static_cast<MessageType*>(out);
-      return instance.try_pop(*typed_out);
+      return queue.dequeue(*typed_out);
+    }
+
+    size_t try_pop_n(void* out, size_t n) override {
+      MessageType* typed_out = static_cast<MessageType*>(out);
+      return queue.dequeue_n(std::span<MessageType>(typed_out, n));
     }
 
-    bool empty() const override { return instance.empty(); }
+    size_t drain(void (*visit)(void*, void*), void* ctx, size_t max) override {
+      auto f = [&](MessageType& m) { visit(ctx, static_cast<void*>(&m)); };
+      if constexpr (requires { queue.drain(f, max); }) {
+        return queue.drain(f, max);
+      } else {
+        std::terminate();  // drain(), but there is nothing to pop the message into
+      }
+    }
+
+    void pop(void* out) override {
+      MessageType* typed_out = static_cast<MessageType*>(out);
+      queue.dequeue_wait(*typed_out);
+    }
 
-    size_t size() const override { return instance.size(); }
+    bool pop(void* out, const std::stop_token& stop) override {
+      MessageType* typed_out = static_cast<MessageType*>(out);
+      return queue.dequeue_wait(*typed_out, stop);
+    }
+
+    bool pop_until(void* out, std::chrono::steady_clock::time_point deadline) override {
+      MessageType* typed_out = static_cast<MessageType*>(out);
+      return queue.dequeue_until(*typed_out, deadline);
+    }
+
+    std::pair<void*, size_t> reserve(size_t n) override {
+      if constexpr (ZeroCopyBackend<std::decay_t<T>>) {
+        std::span<MessageType> slots = queue.reserve(n);
+        return {static_cast<void*>(slots.data()), slots.size()};
+      } else {
+        return {nullptr, 0};
+      }
+    }
+
+    void commit(size_t n) override {
+      if constexpr (ZeroCopyBackend<std::decay_t<T>>) {
+        queue.commit(n);
+      }
+    }
+
+    std::pair<const void*, size_t> peek(size_t n) override {
+      if constexpr (ZeroCopyBackend<std::decay_t<T>>) {
+        std::span<const MessageType> items = queue.peek(n);
+        return {static_cast<const void*>(items.data()), items.size()};
+      } else {
+        return {nullptr, 0};
+      }
+    }
+
+    void release(size_t n) override {
+      if constexpr (ZeroCopyBackend<std::decay_t<T>>) {
+        queue.release(n);
+      }
+    }
+
+    bool empty() const override { return queue.empty(); }
+
+    size_t size() const override { return queue.size(); }
+
+    size_t capacity() const override { return queue.capacity(); }
+
+    BackendFeatures features() const override { return queue.features(); }
 
   private:
-    std::decay_t<T> instance;  // the actual queue
+    // converts into the message, which is then built straight into wherever the
+    // conversion result goes (guaranteed copy elision)
+    struct deferred {
+      factory_t factory;
+
+      operator MessageType() const {
+        return reinterpret_cast<MessageType (*)(void*)>(factory.make)(factory.args);
+      }
+    };
+
+    BasicMsgQueue<std::decay_t<T>> queue;  // the actual queue
   };
 
-  // bridge
-  std::unique_ptr<concept_t> pimpl;
+  // Inline backends are moved along with the queue, whose moves are noexcept, so a
+  // backend that may throw while moving goes to the heap whatever its size.
+  template <typename T>
+  static constexpr bool fits_inline = sizeof(backend<T>) <= InlineSize
+                                   && alignof(backend<T>) <= kCacheLineSize
+                                   && std::is_nothrow_move_constructible_v<std::decay_t<T>>;
+
+  void take(SizedMsgQueue& m) noexcept {
+    if (m.inlined) {
+      pimpl   = m.pimpl->move_to(buffer);
+      inlined = true;
+      m.reset();
+    } else {
+      pimpl   = std::exchange(m.pimpl, nullptr);
+      inlined = false;
+    }
+  }
+
+  void reset() noexcept {
+    if (inlined) {
+      pimpl->~concept_t();
+    } else {
+      delete pimpl;
+    }
+    pimpl   = nullptr;
+    inlined = false;
+  }
+
+  alignas(kCacheLineSize) std::byte buffer[InlineSize];  // holds backends that fit
+  // bridge, points into buffer when the backend is inlined
+  concept_t* pimpl = nullptr;
+  bool inlined     = false;
 };
+
+using MsgQueue = SizedMsgQueue<kMsgQueueInlineSize>;
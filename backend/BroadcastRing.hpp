@@ -0,0 +1,395 @@
+// Copyright 2025 Chuangye Liu <chuangyeliu0206@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <concepts>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stop_token>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "CacheLine.hpp"
+#include "Futex.hpp"
+#include "Parking.hpp"
+#include "RingBuf.hpp"
+#include "RingStorage.hpp"
+#include "TimedPop.hpp"
+#include "WaitStrategy.hpp"
+
+// single producer ring that every reader sees in full, e.g. one market data feed for
+// several strategy threads: the element is written once and read in place by all
+//
+// Every reader owns a cursor, the free running counter of the next element it reads.
+// An element stays in its slot until the producer reuses the slot one lap later, so
+// readers only copy what they want to keep. The number of readers is fixed when the
+// ring is built and each of them has to keep reading, see reader().
+//
+// What push() does when the slowest reader is a whole ring behind (see RingBuf.hpp):
+//  - BlockWhenFull waits for it (see WaitStrategy.hpp), so nobody misses an element.
+//  - DropNewest discards the element being pushed and counts it in dropped().
+//  - OverwriteOldest never waits, a reader that falls behind skips to the oldest
+//    element still there and counts the gap in Reader::lost(). A reader copies an
+//    element and then checks claimed_ to see whether the producer started to
+//    overwrite it meanwhile (a seqlock), so T has to be trivially copyable and the
+//    elements cannot be read in place.
+//
+// Readers can also form a pipeline over the same slots, e.g. decode -> (risk, persist)
+// -> publish: a reader that depends on others (see depends_on()) only reads what all of
+// them have released, its cursor is bounded by theirs as theirs are by head_. So the
+// stages see each element in a fixed order, in place, and the producer only has to wait
+// for the readers nobody depends on, the last stages.
+//
+// try_push() never overwrites, whatever the policy. Capacity has to allocate its slots
+// (DynamicCapacity or PowerOfTwoCapacity).
+template <typename T, typename Capacity = DynamicCapacity, typename Overflow = BlockWhenFull,
+          typename Wait = Park>
+class BroadcastRingBuffer {
+  static constexpr bool kOverwrite = std::same_as<Overflow, OverwriteOldest>;
+  static_assert(!kOverwrite || std::is_trivially_copyable_v<T>,
+                "OverwriteOldest needs a trivially copyable T");
+
+  // each one on its own cache line, the producer reads them all when it looks for space
+  struct alignas(kCacheLineSize) Cursor {
+    std::atomic<std::uint64_t> next{0};  // Next counter to read
+    std::uint64_t cached_limit = 0;      // reader's copy of its limit(), see Reader
+    size_t lost                = 0;      // OverwriteOldest: elements skipped
+    std::vector<Cursor*> upstream;       // cursors this reader stays behind
+    bool has_downstream = false;         // some reader stays behind this one
+  };
+
+public:
+  using BufferElement = T;
+
+  // one reader's view of the ring, only to be used by one thread at a time and only
+  // while the ring stays where it is
+  class Reader : public TimedPop<Reader, T> {
+    friend TimedPop<Reader, T>;
+
+  public:
+    // copies the next element
+    bool try_pop(T& item) {
+      for (;;) {
+        std::uint64_t pos = cursor_->next.load(std::memory_order_relaxed);
+        if (!readable(pos)) {
+          return false;
+        }
+        item = ring_->storage_[pos];
+        if (ring_->intact(pos)) {
+          advance(pos + 1);
+          return true;
+        }
+        skip_lost();
+      }
+    }
+
+    // Up to n of the next elements in place, fewer at the end of the buffer. They stay
+    // valid until this reader hands them back with release(k).
+    std::span<const T> peek(size_t n = 1)
+      requires(!kOverwrite)
+    {
+      return peek_mutable(n);
+    }
+
+    // peek() for a pipeline stage that modifies the elements for the stages behind it.
+    // Readers not ordered by depends_on() see the same elements at the same time, none
+    // of them may touch what this one writes.
+    std::span<T> peek_mutable(size_t n = 1)
+      requires(!kOverwrite)
+    {
+      std::uint64_t pos = cursor_->next.load(std::memory_order_relaxed);
+      if (cursor_->cached_limit - pos < n) {
+        cursor_->cached_limit = limit();
+      }
+      size_t contiguous = ring_->capacity() - ring_->storage_.index(pos);
+      size_t k = std::min({n, static_cast<size_t>(cursor_->cached_limit - pos), contiguous});
+      return {&ring_->storage_[pos], k};
+    }
+
+    void release(size_t n = 1)
+      requires(!kOverwrite)
+    {
+      advance(cursor_->next.load(std::memory_order_relaxed) + n);
+    }
+
+    // elements this reader may read, including any the producer overwrote
+    size_t size() const {
+      std::uint64_t next = cursor_->next.load(std::memory_order_relaxed);
+      return limit() - next;
+    }
+
+    bool empty() const { return size() == 0; }
+
+    // OverwriteOldest: elements this reader missed because it fell a ring behind
+    size_t lost() const { return cursor_->lost; }
+
+  private:
+    friend class BroadcastRingBuffer;
+
+    Reader(BroadcastRingBuffer* ring, Cursor* cursor) : ring_(ring), cursor_(cursor) {}
+
+    // end of what this reader may read: head_, or the slowest upstream cursor
+    std::uint64_t limit() const {
+      if (cursor_->upstream.empty()) {
+        return ring_->head_.load(std::memory_order_acquire);
+      }
+      std::uint64_t end = std::numeric_limits<std::uint64_t>::max();
+      for (const Cursor* upstream : cursor_->upstream) {
+        end = std::min(end, upstream->next.load(std::memory_order_acquire));
+      }
+      return end;
+    }
+
+    // the limit is only reloaded when the ring looks empty to this reader
+    bool readable(std::uint64_t pos) {
+      if (cursor_->cached_limit == pos) {
+        cursor_->cached_limit = limit();
+      }
+      return cursor_->cached_limit != pos;
+    }
+
+    void advance(std::uint64_t next) {
+      cursor_->next.store(next, std::memory_order_release);
+      if (cursor_->has_downstream) {
+        ring_->consumer_parking_.notify_all<Wait>();
+      } else if constexpr (std::same_as<Overflow, BlockWhenFull>) {
+        ring_->producer_parking_.notify_one<Wait>();
+      }
+    }
+
+    // OverwriteOldest: moves on to the oldest element the producer has not claimed
+    void skip_lost() {
+      std::uint64_t pos    = cursor_->next.load(std::memory_order_relaxed);
+      std::uint64_t oldest = ring_->claimed_.load(std::memory_order_relaxed) - ring_->capacity();
+      cursor_->lost += oldest - pos;
+      cursor_->next.store(oldest, std::memory_order_release);
+      // the cached limit may be behind oldest, head_ is not
+      cursor_->cached_limit = limit();
+    }
+
+    // try_pop() for a T that need not be default constructible
+    std::optional<T> take() {
+      for (;;) {
+        std::uint64_t pos = cursor_->next.load(std::memory_order_relaxed);
+        if (!readable(pos)) {
+          return std::nullopt;
+        }
+        std::optional<T> item(ring_->storage_[pos]);
+        if (ring_->intact(pos)) {
+          advance(pos + 1);
+          return item;
+        }
+        skip_lost();
+      }
+    }
+
+    std::optional<T> pop_until_impl(Deadline deadline, const std::stop_token& stop) {
+      for (;;) {
+        if (std::optional<T> item = take()) {
+          return item;
+        }
+        std::uint64_t pos = cursor_->next.load(std::memory_order_relaxed);
+        auto has_data     = [&] { return limit() != pos; };
+        if (!ring_->consumer_parking_.template wait<Wait>(has_data, deadline, stop)) {
+          return std::nullopt;
+        }
+      }
+    }
+
+    BroadcastRingBuffer* ring_;
+    Cursor* cursor_;
+  };
+
+  BroadcastRingBuffer(size_t capacity, size_t readers)
+      : storage_(capacity),
+        cursors_(std::make_unique<Cursor[]>(readers)),
+        readers_(readers) {}
+
+  BroadcastRingBuffer(BroadcastRingBuffer&& other) noexcept
+      : storage_(std::move(other.storage_)),
+        cursors_(std::move(other.cursors_)),
+        readers_(other.readers_),
+        head_(other.head_.load()),
+        claimed_(other.claimed_.load()),
+        cached_min_(other.cached_min_),
+        dropped_(other.dropped_.load()) {}
+
+  BroadcastRingBuffer& operator=(BroadcastRingBuffer&& other) noexcept {
+    if (this != &other) {
+      destroy_all();
+      storage_ = std::move(other.storage_);
+      cursors_ = std::move(other.cursors_);
+      readers_ = other.readers_;
+      head_.store(other.head_.load());
+      claimed_.store(other.claimed_.load());
+      cached_min_ = other.cached_min_;
+      dropped_.store(other.dropped_.load());
+    }
+    return *this;
+  }
+
+  ~BroadcastRingBuffer() { destroy_all(); }
+
+  BroadcastRingBuffer(const BroadcastRingBuffer&)            = delete;
+  BroadcastRingBuffer& operator=(const BroadcastRingBuffer&) = delete;
+
+  // the view of reader i < readers(), every reader starts at the first element pushed
+  Reader reader(size_t i) { return Reader(this, &cursors_[i]); }
+
+  size_t readers() const { return readers_; }
+
+  // Makes reader stay behind upstream, it only reads elements upstream has released.
+  // Only before any element is pushed, and the dependencies must not form a cycle.
+  void depends_on(size_t reader, size_t upstream)
+    requires(!kOverwrite)
+  {
+    cursors_[reader].upstream.push_back(&cursors_[upstream]);
+    cursors_[upstream].has_downstream = true;
+  }
+
+  // pushes an element, the slowest reader being a ring behind is handled according to
+  // Overflow
+  template <typename U>
+    requires std::is_convertible_v<U&&, T>
+  void push(U&& item) {
+    emplace(std::forward<U>(item));
+  }
+
+  // pushes an element unless the slowest reader is a ring behind
+  template <typename U>
+    requires std::is_convertible_v<U&&, T>
+  bool try_push(U&& item) {
+    return try_emplace(std::forward<U>(item));
+  }
+
+  // constructs an element from args directly in its slot, the slowest reader being a
+  // ring behind is handled according to Overflow
+  template <typename... Args>
+    requires std::constructible_from<T, Args&&...>
+  void emplace(Args&&... args) {
+    std::uint64_t pos = head_.load(std::memory_order_relaxed);
+    if constexpr (std::same_as<Overflow, DropNewest>) {
+      if (!has_space(pos)) {
+        dropped_.store(dropped_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return;
+      }
+    } else if constexpr (std::same_as<Overflow, BlockWhenFull>) {
+      if (!has_space(pos)) {
+        producer_parking_.wait<Wait>([&] { return has_space(pos); });
+      }
+    }
+    write(pos, std::forward<Args>(args)...);
+  }
+
+  // constructs an element from args directly in its slot unless the slowest reader is
+  // a ring behind
+  template <typename... Args>
+    requires std::constructible_from<T, Args&&...>
+  bool try_emplace(Args&&... args) {
+    std::uint64_t pos = head_.load(std::memory_order_relaxed);
+    if (!has_space(pos)) {
+      return false;
+    }
+    write(pos, std::forward<Args>(args)...);
+    return true;
+  }
+
+  size_t capacity() const { return storage_.capacity(); }
+
+  // number of elements DropNewest discarded
+  size_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+  static_assert(!RingStorage<T, Capacity>::kInline,
+                "BroadcastRingBuffer needs DynamicCapacity or PowerOfTwoCapacity");
+
+  // producer: whether the slot of pos is free, i.e. every reader is past pos - capacity.
+  // The minimum over the cursors is only recomputed when the cached one says no, and
+  // readers with a downstream are never the slowest.
+  bool has_space(std::uint64_t pos) {
+    if (pos - cached_min_ < capacity()) {
+      return true;
+    }
+    std::uint64_t slowest = pos;
+    for (size_t i = 0; i < readers_; ++i) {
+      if (!cursors_[i].has_downstream) {
+        slowest = std::min(slowest, cursors_[i].next.load(std::memory_order_acquire));
+      }
+    }
+    cached_min_ = slowest;
+    return pos - slowest < capacity();
+  }
+
+  template <typename... Args>
+  void write(std::uint64_t pos, Args&&... args) {
+    if constexpr (kOverwrite) {
+      // readers that copy the slot concurrently see claimed_ and throw their copy away
+      claimed_.store(pos + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+    }
+    if (pos >= capacity()) {
+      std::destroy_at(&storage_[pos]);  // one lap old, every reader is past it
+    }
+    std::construct_at(&storage_[pos], std::forward<Args>(args)...);
+    head_.store(pos + 1, std::memory_order_release);
+    // readers may wait for the same element, wake all of them
+    consumer_parking_.notify_all<Wait>();
+  }
+
+  // reader: whether a copy of the element at pos was taken before the producer began to
+  // overwrite its slot
+  bool intact(std::uint64_t pos) const {
+    if constexpr (kOverwrite) {
+      std::atomic_thread_fence(std::memory_order_acquire);
+      return claimed_.load(std::memory_order_relaxed) <= pos + capacity();
+    } else {
+      return true;
+    }
+  }
+
+  // single threaded use only, the last capacity() slots written hold an element
+  void destroy_all() {
+    if constexpr (!std::is_trivially_destructible_v<T>) {
+      if (cursors_ != nullptr) {  // moved from
+        std::uint64_t head = head_.load();
+        for (std::uint64_t pos = head - std::min<std::uint64_t>(head, capacity()); pos != head;
+             ++pos) {
+          std::destroy_at(&storage_[pos]);
+        }
+      }
+    }
+  }
+
+  RingStorage<T, Capacity> storage_;
+  std::unique_ptr<Cursor[]> cursors_;  // one per reader
+  size_t readers_;
+
+  // producer side, written on every push
+  alignas(kCacheLineSize) std::atomic<std::uint64_t> head_{0};  // Next counter to push
+  std::atomic<std::uint64_t> claimed_{0};  // OverwriteOldest: end of the slots being written
+  std::uint64_t cached_min_ = 0;           // producer's copy of the slowest cursor
+  std::atomic<size_t> dropped_{0};         // written by the producer only
+
+  // only written by a thread that parks, so both sides can keep reading them
+  alignas(kCacheLineSize) ParkingSpot consumer_parking_;
+  ParkingSpot producer_parking_;  // the producer waiting for the slowest reader
+};
@@ -0,0 +1,309 @@
+// Copyright 2025 Chuangye Liu <chuangyeliu0206@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "CacheLine.hpp"
+#include "Parking.hpp"
+#include "RingStorage.hpp"
+#include "WaitStrategy.hpp"
+
+// every record of a ByteRingBuffer, and so every payload, starts at this alignment
+inline constexpr size_t kByteRecordAlign = 8;
+
+// a record in place, valid until the consumer releases it
+struct ByteRecord {
+  std::uint32_t tag;
+  std::span<const std::byte> bytes;
+
+  // the payload as the message that try_emplace<M>() wrote
+  template <typename M>
+  const M& as() const {
+    return *std::launder(reinterpret_cast<const M*>(bytes.data()));
+  }
+};
+
+// a record copied out of the ring, the element type MsgQueue sees
+struct ByteMessage {
+  std::uint32_t tag = 0;
+  std::vector<std::byte> bytes;
+};
+
+// single producer-single consumer ring of variable length records, for mixed traffic
+// where sizing every slot for the largest message would waste most of the memory
+//
+// A record is an 8 byte header {size, tag} followed by size bytes, padded to the next
+// multiple of kByteRecordAlign. head_ and tail_ are free running counters of 8 byte
+// blocks. A record never wraps: when it does not fit before the end of the buffer the
+// producer fills the rest with a padding record, which the consumer skips. So a record
+// may take up to half of the buffer, see max_record_size().
+//
+// reserve()/commit() and peek()/release() write and read records in place. The
+// ValidBackend interface copies whole records in and out as ByteMessage, push() waits
+// (see WaitStrategy.hpp) while the ring is full.
+template <typename Wait = Park>
+class ByteRingBuffer {
+  struct alignas(kByteRecordAlign) Block {
+    std::byte bytes[kByteRecordAlign];
+  };
+
+  struct RecordHeader {
+    std::uint32_t size;
+    std::uint32_t tag;
+  };
+  static_assert(sizeof(RecordHeader) == sizeof(Block));
+
+  static constexpr std::uint32_t kPaddingTag = ~std::uint32_t{0};
+
+  // a record of one header and one payload block must fit in half of the buffer
+  static constexpr size_t kMinBlocks = 4;
+
+public:
+  using BufferElement = ByteMessage;
+
+  // capacity is in bytes, at least 32 and rounded up to a power of two
+  explicit ByteRingBuffer(size_t capacity = 4096)
+      : storage_(std::max((capacity + kByteRecordAlign - 1) / kByteRecordAlign, kMinBlocks)) {}
+
+  ByteRingBuffer(ByteRingBuffer&& other) noexcept
+      : storage_(std::move(other.storage_)),
+        head_(other.head_.load()),
+        pushed_(other.pushed_.load()),
+        dropped_(other.dropped_.load()),
+        cached_tail_(other.cached_tail_),
+        reserved_at_(other.reserved_at_),
+        tail_(other.tail_.load()),
+        popped_(other.popped_.load()),
+        cached_head_(other.cached_head_),
+        peeked_end_(other.peeked_end_) {}
+
+  ByteRingBuffer& operator=(ByteRingBuffer&& other) noexcept {
+    if (this != &other) {
+      storage_ = std::move(other.storage_);
+      head_.store(other.head_.load());
+      pushed_.store(other.pushed_.load());
+      dropped_.store(other.dropped_.load());
+      cached_tail_ = other.cached_tail_;
+      reserved_at_ = other.reserved_at_;
+      tail_.store(other.tail_.load());
+      popped_.store(other.popped_.load());
+      cached_head_ = other.cached_head_;
+      peeked_end_  = other.peeked_end_;
+    }
+    return *this;
+  }
+
+  ByteRingBuffer(const ByteRingBuffer&)            = delete;
+  ByteRingBuffer& operator=(const ByteRingBuffer&) = delete;
+
+  // Producer: size bytes to write a record tagged tag into, published with commit().
+  // A null span if the ring has no room right now or size exceeds max_record_size().
+  // Tag ~0u is reserved for padding. Any other producer call drops the reservation.
+  std::span<std::byte> reserve(size_t size, std::uint32_t tag) {
+    if (size > max_record_size() || tag == kPaddingTag) {
+      return {};
+    }
+    std::uint64_t pos = head_.load(std::memory_order_relaxed);
+    size_t blocks     = record_blocks(size);
+    size_t offset     = storage_.index(pos);
+    size_t padding    = offset + blocks > capacity_blocks() ? capacity_blocks() - offset : 0;
+    if (!has_space(pos, padding + blocks)) {
+      return {};
+    }
+    if (padding != 0) {
+      header(pos) = {static_cast<std::uint32_t>((padding - 1) * kByteRecordAlign), kPaddingTag};
+      pos += padding;
+    }
+    header(pos)  = {static_cast<std::uint32_t>(size), tag};
+    reserved_at_ = pos;
+    return {payload(pos), size};
+  }
+
+  // publishes the reserved record with its first size bytes, by default all of them.
+  // size must not exceed the reserved size, a larger one is cut to it.
+  void commit() { commit(header(reserved_at_).size); }
+
+  void commit(size_t size) {
+    RecordHeader& h = header(reserved_at_);
+    assert(size <= h.size);
+    h.size = static_cast<std::uint32_t>(std::min<size_t>(size, h.size));
+    // counted before it is published, so it is never released before it is counted
+    pushed_.store(pushed_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    head_.store(reserved_at_ + record_blocks(h.size), std::memory_order_release);
+  }
+
+  // constructs a trivially copyable M in a new record, false if the ring is full
+  template <typename M, typename... Args>
+    requires std::is_trivially_copyable_v<M> && (alignof(M) <= kByteRecordAlign)
+             && std::constructible_from<M, Args&&...>
+  bool try_emplace(std::uint32_t tag, Args&&... args) {
+    std::span<std::byte> bytes = reserve(sizeof(M), tag);
+    if (bytes.empty()) {
+      return false;
+    }
+    ::new (bytes.data()) M(std::forward<Args>(args)...);
+    commit();
+    return true;
+  }
+
+  // Consumer: the oldest record in place, handed back with release(). Calling peek()
+  // again without release() returns the same record.
+  std::optional<ByteRecord> peek() {
+    std::uint64_t pos = tail_.load(std::memory_order_relaxed);
+    if (!readable(pos)) {
+      return std::nullopt;
+    }
+    if (header(pos).tag == kPaddingTag) {
+      // published together with the record behind it
+      pos += record_blocks(header(pos).size);
+    }
+    RecordHeader h = header(pos);
+    peeked_end_    = pos + record_blocks(h.size);
+    return ByteRecord{h.tag, {payload(pos), h.size}};
+  }
+
+  // hands the peeked record back to the producer
+  void release() {
+    tail_.store(peeked_end_, std::memory_order_release);
+    popped_.store(popped_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    producer_parking_.notify_one<Wait>();
+  }
+
+  // Copies message into a new record, waits while the ring is full. A message that can
+  // never fit, longer than max_record_size() or tagged ~0u, is dropped and counted in
+  // dropped() instead.
+  void push(const ByteMessage& message) {
+    if (message.bytes.size() > max_record_size() || message.tag == kPaddingTag) {
+      dropped_.store(dropped_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      return;
+    }
+    for (;;) {
+      // read before the attempt, so a release right after it is not missed
+      std::uint64_t tail = tail_.load(std::memory_order_acquire);
+      if (try_push(message)) {
+        return;
+      }
+      producer_parking_.wait<Wait>([&] { return tail_.load(std::memory_order_acquire) != tail; });
+    }
+  }
+
+  bool try_push(const ByteMessage& message) {
+    std::span<std::byte> bytes = reserve(message.bytes.size(), message.tag);
+    if (bytes.data() == nullptr) {
+      return false;
+    }
+    std::copy(message.bytes.begin(), message.bytes.end(), bytes.begin());
+    commit();
+    return true;
+  }
+
+  bool try_pop(ByteMessage& message) {
+    std::optional<ByteRecord> record = peek();
+    if (!record) {
+      return false;
+    }
+    message.tag = record->tag;
+    message.bytes.assign(record->bytes.begin(), record->bytes.end());
+    release();
+    return true;
+  }
+
+  // number of records, every record takes at least one block
+  size_t size() const {
+    size_t popped = popped_.load(std::memory_order_acquire);
+    size_t pushed = pushed_.load(std::memory_order_relaxed);
+    return pushed > popped ? std::min(pushed - popped, capacity_blocks()) : 0;
+  }
+
+  bool empty() const {
+    return head_.load(std::memory_order_relaxed) == tail_.load(std::memory_order_relaxed);
+  }
+
+  // bytes taken by records, headers and padding
+  size_t used_bytes() const {
+    std::uint64_t current_tail = tail_.load(std::memory_order_acquire);
+    return (head_.load(std::memory_order_relaxed) - current_tail) * kByteRecordAlign;
+  }
+
+  size_t capacity_bytes() const { return capacity_blocks() * kByteRecordAlign; }
+
+  // number of messages push() dropped because they can never fit
+  size_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+  // largest payload that reserve() accepts
+  size_t max_record_size() const { return (capacity_blocks() / 2 - 1) * kByteRecordAlign; }
+
+private:
+  static size_t record_blocks(size_t size) {
+    return 1 + (size + kByteRecordAlign - 1) / kByteRecordAlign;
+  }
+
+  size_t capacity_blocks() const { return storage_.capacity(); }
+
+  RecordHeader& header(std::uint64_t pos) {
+    return *std::launder(reinterpret_cast<RecordHeader*>(&storage_[pos]));
+  }
+
+  std::byte* payload(std::uint64_t pos) { return storage_[pos + 1].bytes; }
+
+  // producer: whether n blocks from pos are free, tail_ is only reloaded when the
+  // cached copy says no
+  bool has_space(std::uint64_t pos, size_t n) {
+    if (pos + n - cached_tail_ > capacity_blocks()) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+    }
+    return pos + n - cached_tail_ <= capacity_blocks();
+  }
+
+  // consumer: whether a record starts at pos, head_ is only reloaded when the ring
+  // looks empty
+  bool readable(std::uint64_t pos) {
+    if (cached_head_ == pos) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+    }
+    return cached_head_ != pos;
+  }
+
+  RingStorage<Block, PowerOfTwoCapacity> storage_;
+
+  // producer side, written on every commit
+  alignas(kCacheLineSize) std::atomic<std::uint64_t> head_{0};  // End of the last commit
+  std::atomic<size_t> pushed_{0};    // records committed, written by the producer only
+  std::atomic<size_t> dropped_{0};   // written by the producer only
+  std::uint64_t cached_tail_ = 0;    // producer's copy of tail_
+  std::uint64_t reserved_at_ = 0;    // header of the reserved record
+
+  // consumer side, written on every release
+  alignas(kCacheLineSize) std::atomic<std::uint64_t> tail_{0};  // Start of the oldest record
+  std::atomic<size_t> popped_{0};    // records released, written by the consumer only
+  std::uint64_t cached_head_ = 0;    // consumer's copy of head_
+  std::uint64_t peeked_end_  = 0;    // end of the peeked record
+
+  // only written by a producer that parks
+  alignas(kCacheLineSize) ParkingSpot producer_parking_;
+};
@@ -0,0 +1,226 @@
+// Copyright 2025 Chuangye Liu <chuangyeliu0206@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <concepts>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <stop_token>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+#include "RingBuf.hpp"
+#include "RingStorage.hpp"
+#include "TimedPop.hpp"
+#include "WaitStrategy.hpp"
+
+// single producer-single consumer queue that holds at most one message per key, e.g.
+// one update per instrument: a push for a key whose last message has not been popped
+// yet replaces that message where it is in the queue instead of appending
+//
+// Every key gets a slot the first time it is pushed, the slots are never given back, so
+// the queue needs as many as there are distinct keys. The order of the queue is a
+// RingBuffer of slot numbers, which never fills up because a slot is in it at most
+// once, and whose pop() is what the consumer waits in (see WaitStrategy.hpp).
+//
+// A slot is Idle (not in the queue), Queued or Busy (one side is moving the message in
+// or out). Replacing a queued message and popping it both go through Busy, so the side
+// that comes second waits for the other to finish the move. The producer alone owns
+// the key -> slot map.
+template <typename T, typename KeyOf, typename Wait = Park>
+  requires std::invocable<const KeyOf&, const T&>
+class ConflatingQueue : public TimedPop<ConflatingQueue<T, KeyOf, Wait>, T> {
+  friend TimedPop<ConflatingQueue, T>;
+
+  using Key = std::decay_t<std::invoke_result_t<const KeyOf&, const T&>>;
+
+  enum State : std::uint8_t { kIdle, kQueued, kBusy };
+
+  struct Slot {
+    std::atomic<State> state{kIdle};
+    std::optional<T> value;
+  };
+
+public:
+  using BufferElement = T;
+
+  // room for keys distinct keys
+  explicit ConflatingQueue(size_t keys, KeyOf key_of = {})
+      : key_of_(std::move(key_of)),
+        slots_(std::make_unique<Slot[]>(keys)),
+        keys_(keys),
+        order_(keys) {
+    index_.reserve(keys);
+  }
+
+  ConflatingQueue(ConflatingQueue&& other) noexcept
+      : key_of_(std::move(other.key_of_)),
+        slots_(std::move(other.slots_)),
+        keys_(other.keys_),
+        index_(std::move(other.index_)),
+        conflated_(other.conflated_.load()),
+        dropped_(other.dropped_.load()),
+        order_(std::move(other.order_)) {}
+
+  ConflatingQueue& operator=(ConflatingQueue&& other) noexcept {
+    if (this != &other) {
+      key_of_ = std::move(other.key_of_);
+      slots_  = std::move(other.slots_);
+      keys_   = other.keys_;
+      index_  = std::move(other.index_);
+      conflated_.store(other.conflated_.load());
+      dropped_.store(other.dropped_.load());
+      order_ = std::move(other.order_);
+    }
+    return *this;
+  }
+
+  ConflatingQueue(const ConflatingQueue&)            = delete;
+  ConflatingQueue& operator=(const ConflatingQueue&) = delete;
+
+  // Queues a message, or replaces the one still queued for its key. A message for a
+  // new key when all keys are taken is dropped and counted in dropped(). A copy that
+  // may throw is made before the slot is taken, see ClaimConstructible.
+  template <typename U>
+    requires std::is_convertible_v<U&&, T> && ClaimConstructible<T, U&&>
+  void push(U&& item) {
+    try_push(std::forward<U>(item));
+  }
+
+  // push() that says whether the message was queued or replaced one
+  template <typename U>
+    requires std::is_convertible_v<U&&, T> && ClaimConstructible<T, U&&>
+  bool try_push(U&& item) {
+    if constexpr (std::same_as<std::remove_cvref_t<U>, T>
+                  && std::is_nothrow_constructible_v<T, U&&>) {
+      Slot* slot = find_slot(std::invoke(key_of_, std::as_const(item)));
+      if (slot == nullptr) {
+        dropped_.store(dropped_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return false;
+      }
+      store(*slot, std::forward<U>(item));
+      return true;
+    } else {
+      return try_push(T(std::forward<U>(item)));
+    }
+  }
+
+  bool try_pop(T& item) {
+    std::uint32_t index = 0;
+    if (!order_.try_pop(index)) {
+      return false;
+    }
+    item = take(index);
+    return true;
+  }
+
+  // number of keys with a queued message
+  size_t size() const { return order_.size(); }
+
+  bool empty() const { return order_.empty(); }
+
+  // a queued message per key at most
+  size_t capacity() const { return keys_; }
+
+  // number of messages that replaced a queued one
+  size_t conflated() const { return conflated_.load(std::memory_order_relaxed); }
+
+  // number of messages dropped because all keys were taken
+  size_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+  // producer: the slot of key, a free one the first time key is seen
+  Slot* find_slot(const Key& key) {
+    if (auto it = index_.find(key); it != index_.end()) {
+      return &slots_[it->second];
+    }
+    if (index_.size() == keys_) {
+      return nullptr;
+    }
+    auto index = static_cast<std::uint32_t>(index_.size());
+    index_.emplace(key, index);
+    return &slots_[index];
+  }
+
+  // producer: replaces the queued message in slot, or queues slot when it is idle. A
+  // busy slot is only left once the message is in, so building it must not throw.
+  template <typename U>
+    requires std::is_nothrow_constructible_v<T, U&&>
+  void store(Slot& slot, U&& item) {
+    for (unsigned i = 0;; ++i) {
+      State state = slot.state.load(std::memory_order_acquire);
+      if (state == kQueued) {
+        if (slot.state.compare_exchange_strong(state, kBusy, std::memory_order_acquire)) {
+          slot.value.emplace(std::forward<U>(item));
+          slot.state.store(kQueued, std::memory_order_release);
+          conflated_.store(conflated_.load(std::memory_order_relaxed) + 1,
+                           std::memory_order_relaxed);
+          return;
+        }
+      } else if (state == kIdle) {
+        slot.value.emplace(std::forward<U>(item));
+        slot.state.store(kQueued, std::memory_order_relaxed);
+        // the ring's release publishes the message and the state together
+        order_.push(static_cast<std::uint32_t>(&slot - slots_.get()));
+        return;
+      } else {
+        spin_.idle(i);  // the consumer is moving the old message out
+      }
+    }
+  }
+
+  // consumer: moves the message out of a popped slot and makes the slot idle
+  T take(std::uint32_t index) {
+    Slot& slot = slots_[index];
+    for (unsigned i = 0;; ++i) {
+      State state = kQueued;
+      if (slot.state.compare_exchange_weak(state, kBusy, std::memory_order_acquire)) {
+        break;
+      }
+      spin_.idle(i);  // the producer is replacing the message
+    }
+    T item = std::move(*slot.value);
+    slot.value.reset();
+    slot.state.store(kIdle, std::memory_order_release);
+    return item;
+  }
+
+  std::optional<T> pop_until_impl(Deadline deadline, const std::stop_token& stop) {
+    return take(order_.pop_until(deadline, stop));
+  }
+
+  std::optional<T> take(std::optional<std::uint32_t> index) {
+    if (!index) {
+      return std::nullopt;
+    }
+    return take(*index);
+  }
+
+  KeyOf key_of_;
+  std::unique_ptr<Slot[]> slots_;  // one per key, shared by both sides
+  size_t keys_;
+  std::unordered_map<Key, std::uint32_t> index_;  // producer only
+  std::atomic<size_t> conflated_{0};               // written by the producer only
+  std::atomic<size_t> dropped_{0};                 // written by the producer only
+  [[no_unique_address]] SpinThenYield<> spin_;
+
+  // slot numbers in queue order, with the consumer's parking spot
+  RingBuffer<std::uint32_t, DynamicCapacity, DropNewest, Wait> order_;
+};
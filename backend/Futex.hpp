@@ -0,0 +1,92 @@
+// Copyright 2025 Chuangye Liu <chuangyeliu0206@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <thread>
+
+#if defined(__linux__)
+#  include <linux/futex.h>
+#  include <sys/syscall.h>
+#  include <unistd.h>
+
+#  include <cerrno>
+#  include <ctime>
+#endif
+
+// Thin wrapper around a futex on a 32-bit word. std::atomic::wait has no timeout, the
+// futex syscall has one, so timed blocking operations park here instead of polling.
+
+using Deadline = std::chrono::steady_clock::time_point;
+
+// Parks while word == expected until futex_wake_*() or the deadline. Returns false only
+// when the deadline has passed. Wake-ups can be spurious, callers re-check their state.
+inline bool futex_wait_until(std::atomic<std::uint32_t>& word, std::uint32_t expected,
+                             Deadline deadline = Deadline::max()) {
+#if defined(__linux__)
+  static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t));
+  timespec ts{};
+  const timespec* timeout = nullptr;
+  if (deadline != Deadline::max()) {
+    // FUTEX_WAIT_BITSET takes an absolute CLOCK_MONOTONIC time, which is steady_clock
+    auto since_epoch = deadline.time_since_epoch();
+    if (since_epoch.count() < 0) {
+      return false;
+    }
+    auto secs  = std::chrono::duration_cast<std::chrono::seconds>(since_epoch);
+    ts.tv_sec  = static_cast<time_t>(secs.count());
+    ts.tv_nsec = static_cast<long>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(since_epoch - secs).count());
+    timeout = &ts;
+  }
+  long rc = syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAIT_BITSET_PRIVATE,
+                    expected, timeout, nullptr, FUTEX_BITSET_MATCH_ANY);
+  return !(rc == -1 && errno == ETIMEDOUT);
+#else
+  if (deadline == Deadline::max()) {
+    word.wait(expected, std::memory_order_acquire);
+    return true;
+  }
+  // no timed atomic wait in the standard library, fall back to short naps
+  while (word.load(std::memory_order_acquire) == expected) {
+    if (std::chrono::steady_clock::now() >= deadline) {
+      return false;
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(50));
+  }
+  return true;
+#endif
+}
+
+inline void futex_wake_one(std::atomic<std::uint32_t>& word) {
+#if defined(__linux__)
+  syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAKE_PRIVATE, 1, nullptr,
+          nullptr, 0);
+#else
+  word.notify_one();
+#endif
+}
+
+inline void futex_wake_all(std::atomic<std::uint32_t>& word) {
+#if defined(__linux__)
+  syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAKE_PRIVATE, INT_MAX,
+          nullptr, nullptr, 0);
+#else
+  word.notify_all();
+#endif
+}
@@ -0,0 +1,247 @@
+// Copyright 2025 Chuangye Liu <chuangyeliu0206@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <concepts>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <stop_token>
+#include <type_traits>
+#include <utility>
+
+#include "CacheLine.hpp"
+#include "Futex.hpp"
+#include "Parking.hpp"
+#include "RingStorage.hpp"
+#include "TimedPop.hpp"
+#include "WaitStrategy.hpp"
+
+// bounded multi producer-multi consumer ring buffer, e.g. a task queue for a worker pool
+//
+// Dmitry Vyukov's array queue: every slot carries a sequence number that equals the
+// counter pos of the producer that may write the slot next, pos + 1 once the element is
+// there and pos + capacity after a consumer has taken it. Producers claim counters on
+// head_ and consumers on tail_, each with a CAS that only succeeds when the slot is in
+// the right state, so nobody ever holds a slot it cannot use right away.
+//
+// The blocking push() and pop() retry their try_ variant and idle (see WaitStrategy.hpp)
+// in between, so a timed or cancelled pop never leaves a claimed slot behind.
+//
+// Capacity has to allocate its slots (DynamicCapacity or PowerOfTwoCapacity), the ring
+// is moved by handing the allocation over.
+template <typename T, typename Capacity = DynamicCapacity, typename Wait = Park>
+class MpmcRingBuffer : public TimedPop<MpmcRingBuffer<T, Capacity, Wait>, T> {
+  friend TimedPop<MpmcRingBuffer, T>;
+
+  struct Cell {
+    explicit Cell(std::uint64_t s) : seq(s) {}
+
+    T* get() { return reinterpret_cast<T*>(&value); }
+
+    std::atomic<std::uint64_t> seq;
+    RawSlot<T> value;  // constructed while seq == pos + 1
+  };
+
+public:
+  using BufferElement = T;
+
+  static constexpr bool kMultiProducer = true;
+  static constexpr bool kMultiConsumer = true;
+
+  explicit MpmcRingBuffer(size_t capacity = 128) : storage_(capacity) {
+    for (std::uint64_t i = 0; i < storage_.capacity(); ++i) {
+      std::construct_at(&storage_[i], i);
+    }
+  }
+
+  MpmcRingBuffer(MpmcRingBuffer&& other) noexcept
+      : storage_(std::move(other.storage_)),
+        head_(other.head_.load()),
+        tail_(other.tail_.load()) {}
+
+  MpmcRingBuffer& operator=(MpmcRingBuffer&& other) noexcept {
+    if (this != &other) {
+      destroy_all();
+      storage_ = std::move(other.storage_);
+      head_.store(other.head_.load());
+      tail_.store(other.tail_.load());
+    }
+    return *this;
+  }
+
+  ~MpmcRingBuffer() { destroy_all(); }
+
+  MpmcRingBuffer(const MpmcRingBuffer&)            = delete;
+  MpmcRingBuffer& operator=(const MpmcRingBuffer&) = delete;
+
+  // pushes an element, waits for a consumer while the ring is full
+  template <typename U>
+    requires std::is_convertible_v<U&&, T>
+  void push(U&& item) {
+    emplace(std::forward<U>(item));
+  }
+
+  // pushes an element unless the ring is full
+  template <typename U>
+    requires std::is_convertible_v<U&&, T>
+  bool try_push(U&& item) {
+    return try_emplace(std::forward<U>(item));
+  }
+
+  // Constructs an element from args directly in its slot, waits while the ring is full.
+  // A constructor that may throw builds a temporary first, see ClaimConstructible.
+  template <typename... Args>
+    requires ClaimConstructible<T, Args&&...>
+  void emplace(Args&&... args) {
+    if constexpr (!std::is_nothrow_constructible_v<T, Args&&...>) {
+      return emplace(T(std::forward<Args>(args)...));
+    }
+    // args are only consumed by the attempt that succeeds
+    while (!try_emplace(std::forward<Args>(args)...)) {
+      producer_parking_.wait<Wait>([this] { return has_space(); });
+    }
+  }
+
+  // constructs an element from args directly in its slot unless the ring is full
+  template <typename... Args>
+    requires ClaimConstructible<T, Args&&...>
+  bool try_emplace(Args&&... args) {
+    if constexpr (!std::is_nothrow_constructible_v<T, Args&&...>) {
+      return try_emplace(T(std::forward<Args>(args)...));
+    }
+    std::uint64_t pos = head_.load(std::memory_order_relaxed);
+    for (;;) {
+      Cell& cell        = storage_[pos];
+      std::uint64_t seq = cell.seq.load(std::memory_order_acquire);
+      if (seq == pos) {
+        if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          std::construct_at(cell.get(), std::forward<Args>(args)...);
+          cell.seq.store(pos + 1, std::memory_order_release);
+          consumer_parking_.notify_one<Wait>();
+          return true;
+        }
+      } else if (static_cast<std::int64_t>(seq - pos) < 0) {
+        return false;  // the slot still holds the element from one lap ago
+      } else {
+        pos = head_.load(std::memory_order_relaxed);  // another producer took pos
+      }
+    }
+  }
+
+  bool try_pop(T& item) {
+    Cell* cell = claim_readable();
+    if (cell == nullptr) {
+      return false;
+    }
+    item = std::move(*cell->get());
+    release(*cell);
+    return true;
+  }
+
+  // includes slots a producer has claimed but not written yet
+  size_t size() const {
+    std::uint64_t current_tail = tail_.load(std::memory_order_acquire);
+    std::uint64_t current_head = head_.load(std::memory_order_relaxed);
+    return current_head > current_tail
+               ? std::min<size_t>(current_head - current_tail, storage_.capacity())
+               : 0;
+  }
+
+  bool empty() const {
+    return head_.load(std::memory_order_relaxed) == tail_.load(std::memory_order_relaxed);
+  }
+
+  size_t capacity() const { return storage_.capacity(); }
+
+private:
+  static_assert(!RingStorage<Cell, Capacity>::kInline,
+                "MpmcRingBuffer needs DynamicCapacity or PowerOfTwoCapacity");
+
+  // consumer: claims the oldest element, nullptr if the ring is empty
+  Cell* claim_readable() {
+    std::uint64_t pos = tail_.load(std::memory_order_relaxed);
+    for (;;) {
+      Cell& cell        = storage_[pos];
+      std::uint64_t seq = cell.seq.load(std::memory_order_acquire);
+      if (seq == pos + 1) {
+        if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          return &cell;
+        }
+      } else if (static_cast<std::int64_t>(seq - (pos + 1)) < 0) {
+        return nullptr;  // not written yet
+      } else {
+        pos = tail_.load(std::memory_order_relaxed);  // another consumer took pos
+      }
+    }
+  }
+
+  // consumer: ends the lifetime of a claimed element and hands its slot back
+  void release(Cell& cell) {
+    std::destroy_at(cell.get());
+    cell.seq.store(cell.seq.load(std::memory_order_relaxed) - 1 + storage_.capacity(),
+                   std::memory_order_release);
+    producer_parking_.notify_one<Wait>();
+  }
+
+  bool has_space() {
+    std::uint64_t pos = head_.load(std::memory_order_relaxed);
+    return storage_[pos].seq.load(std::memory_order_acquire) == pos;
+  }
+
+  bool has_data() {
+    std::uint64_t pos = tail_.load(std::memory_order_relaxed);
+    return storage_[pos].seq.load(std::memory_order_acquire) == pos + 1;
+  }
+
+  std::optional<T> pop_until_impl(Deadline deadline, const std::stop_token& stop) {
+    for (;;) {
+      if (Cell* cell = claim_readable(); cell != nullptr) {
+        T item = std::move(*cell->get());
+        release(*cell);
+        return item;
+      }
+      if (!consumer_parking_.wait<Wait>([this] { return has_data(); }, deadline, stop)) {
+        return std::nullopt;
+      }
+    }
+  }
+
+  // single threaded use only, every claimed counter below head_ has been written
+  void destroy_all() {
+    if constexpr (!std::is_trivially_destructible_v<T>) {
+      if (storage_.data() != nullptr) {  // moved from
+        for (std::uint64_t pos = tail_.load(); pos != head_.load(); ++pos) {
+          std::destroy_at(storage_[pos].get());
+        }
+      }
+    }
+  }
+
+  RingStorage<Cell, Capacity> storage_;  // slots and their sequence numbers
+
+  // producers, every push does a CAS here
+  alignas(kCacheLineSize) std::atomic<std::uint64_t> head_{0};  // Next counter to claim
+
+  // consumers, every pop does a CAS here
+  alignas(kCacheLineSize) std::atomic<std::uint64_t> tail_{0};  // Next counter to pop
+
+  // only written by a thread that parks, so both sides can keep reading them
+  alignas(kCacheLineSize) ParkingSpot consumer_parking_;
+  ParkingSpot producer_parking_;  // producers waiting for a full ring
+};
@@ -0,0 +1,273 @@
+// Copyright 2025 Chuangye Liu <chuangyeliu0206@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <concepts>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <stop_token>
+#include <type_traits>
+#include <utility>
+
+#include "CacheLine.hpp"
+#include "Futex.hpp"
+#include "Parking.hpp"
+#include "RingStorage.hpp"
+#include "TimedPop.hpp"
+#include "WaitStrategy.hpp"
+
+// bounded multi producer-single consumer ring buffer, for fan-in from many threads
+//
+// Every slot carries a sequence number that says whose turn it is: it equals the
+// counter pos of the producer that may write the slot next, and pos + 1 once that
+// producer has constructed the element. The consumer sets it to pos + capacity when it
+// hands the slot back. Producers claim counters on head_, the single consumer owns
+// tail_ and never needs a CAS.
+//
+// push() claims its counter with a fetch_add and then waits (see WaitStrategy.hpp) for
+// the slot, so a full ring applies backpressure. try_push() only claims a counter whose
+// slot is free and never waits.
+//
+// Capacity has to allocate its slots (DynamicCapacity or PowerOfTwoCapacity), the ring
+// is moved by handing the allocation over.
+template <typename T, typename Capacity = DynamicCapacity, typename Wait = Park>
+class MpscRingBuffer : public TimedPop<MpscRingBuffer<T, Capacity, Wait>, T> {
+  friend TimedPop<MpscRingBuffer, T>;
+
+  struct Cell {
+    explicit Cell(std::uint64_t s) : seq(s) {}
+
+    T* get() { return reinterpret_cast<T*>(&value); }
+
+    std::atomic<std::uint64_t> seq;
+    RawSlot<T> value;  // constructed while seq == pos + 1
+  };
+
+public:
+  using BufferElement = T;
+
+  static constexpr bool kMultiProducer = true;
+
+  explicit MpscRingBuffer(size_t capacity = 128) : storage_(capacity) {
+    for (std::uint64_t i = 0; i < storage_.capacity(); ++i) {
+      std::construct_at(&storage_[i], i);
+    }
+  }
+
+  MpscRingBuffer(MpscRingBuffer&& other) noexcept
+      : storage_(std::move(other.storage_)),
+        head_(other.head_.load()),
+        tail_(other.tail_.load()) {}
+
+  MpscRingBuffer& operator=(MpscRingBuffer&& other) noexcept {
+    if (this != &other) {
+      destroy_all();
+      storage_ = std::move(other.storage_);
+      head_.store(other.head_.load());
+      tail_.store(other.tail_.load());
+    }
+    return *this;
+  }
+
+  ~MpscRingBuffer() { destroy_all(); }
+
+  MpscRingBuffer(const MpscRingBuffer&)            = delete;
+  MpscRingBuffer& operator=(const MpscRingBuffer&) = delete;
+
+  // pushes an element, waits for the consumer while the ring is full
+  template <typename U>
+    requires std::is_convertible_v<U&&, T>
+  void push(U&& item) {
+    emplace(std::forward<U>(item));
+  }
+
+  // pushes an element unless the ring is full
+  template <typename U>
+    requires std::is_convertible_v<U&&, T>
+  bool try_push(U&& item) {
+    return try_emplace(std::forward<U>(item));
+  }
+
+  // Constructs an element from args directly in its slot, waits while the ring is full.
+  // A constructor that may throw builds a temporary first, see ClaimConstructible.
+  template <typename... Args>
+    requires ClaimConstructible<T, Args&&...>
+  void emplace(Args&&... args) {
+    if constexpr (!std::is_nothrow_constructible_v<T, Args&&...>) {
+      return emplace(T(std::forward<Args>(args)...));
+    }
+    std::uint64_t pos = head_.fetch_add(1, std::memory_order_relaxed);
+    Cell& cell        = storage_[pos];
+    if (cell.seq.load(std::memory_order_acquire) != pos) {
+      producer_parking_.wait<Wait>(
+          [&] { return cell.seq.load(std::memory_order_acquire) == pos; });
+    }
+    std::construct_at(cell.get(), std::forward<Args>(args)...);
+    publish(cell, pos);
+  }
+
+  // constructs an element from args directly in its slot unless the ring is full
+  template <typename... Args>
+    requires ClaimConstructible<T, Args&&...>
+  bool try_emplace(Args&&... args) {
+    if constexpr (!std::is_nothrow_constructible_v<T, Args&&...>) {
+      return try_emplace(T(std::forward<Args>(args)...));
+    }
+    std::uint64_t pos = head_.load(std::memory_order_relaxed);
+    for (;;) {
+      Cell& cell        = storage_[pos];
+      std::uint64_t seq = cell.seq.load(std::memory_order_acquire);
+      if (seq == pos) {
+        if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          std::construct_at(cell.get(), std::forward<Args>(args)...);
+          publish(cell, pos);
+          return true;
+        }
+      } else if (static_cast<std::int64_t>(seq - pos) < 0) {
+        return false;  // the slot still holds the element from one lap ago
+      } else {
+        pos = head_.load(std::memory_order_relaxed);  // another producer took pos
+      }
+    }
+  }
+
+  bool try_pop(T& item) {
+    std::uint64_t pos = tail_.load(std::memory_order_relaxed);
+    Cell& cell        = storage_[pos];
+    if (!readable(cell, pos)) {
+      return false;
+    }
+    item = std::move(*cell.get());
+    std::destroy_at(cell.get());
+    finish_read(pos, 1);
+    return true;
+  }
+
+  // Calls f(T&) on up to max elements in place, oldest first, and destroys each one
+  // afterwards. tail_ is published once for the whole batch. If f throws, the elements
+  // before the one it threw on are consumed and that one stays queued.
+  template <typename F>
+  size_t drain(F&& f, size_t max = std::numeric_limits<size_t>::max()) {
+    std::uint64_t first = tail_.load(std::memory_order_relaxed);
+    size_t n            = 0;
+    // publishes tail_ behind the slots already handed back, also while unwinding
+    struct Finish {
+      MpscRingBuffer* ring;
+      std::uint64_t first;
+      const size_t& n;
+      ~Finish() {
+        if (n != 0) {
+          ring->tail_.store(first + n, std::memory_order_release);
+          ring->producer_parking_.notify_all<Wait>();
+        }
+      }
+    } finish{this, first, n};
+    for (; n < max && n < storage_.capacity(); ++n) {
+      Cell& cell = storage_[first + n];
+      if (!readable(cell, first + n)) {
+        break;
+      }
+      f(*cell.get());
+      std::destroy_at(cell.get());
+      // the slot goes back now, a spinning producer takes it right away, parked ones
+      // are woken once for the whole batch
+      cell.seq.store(first + n + storage_.capacity(), std::memory_order_release);
+    }
+    return n;
+  }
+
+  // includes slots a producer has claimed but not written yet
+  size_t size() const {
+    std::uint64_t current_tail = tail_.load(std::memory_order_acquire);
+    std::uint64_t current_head = head_.load(std::memory_order_relaxed);
+    return current_head > current_tail
+               ? std::min<size_t>(current_head - current_tail, storage_.capacity())
+               : 0;
+  }
+
+  bool empty() const {
+    return head_.load(std::memory_order_relaxed) == tail_.load(std::memory_order_relaxed);
+  }
+
+  size_t capacity() const { return storage_.capacity(); }
+
+private:
+  static_assert(!RingStorage<Cell, Capacity>::kInline,
+                "MpscRingBuffer needs DynamicCapacity or PowerOfTwoCapacity");
+
+  static bool readable(Cell& cell, std::uint64_t pos) {
+    return cell.seq.load(std::memory_order_acquire) == pos + 1;
+  }
+
+  // producer: hands the element at pos to the consumer
+  void publish(Cell& cell, std::uint64_t pos) {
+    cell.seq.store(pos + 1, std::memory_order_release);
+    consumer_parking_.notify_one<Wait>();
+  }
+
+  // consumer: hands [first, first + n) back to the producers
+  void finish_read(std::uint64_t first, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+      storage_[first + i].seq.store(first + i + storage_.capacity(), std::memory_order_release);
+    }
+    tail_.store(first + n, std::memory_order_release);
+    // producers wait for different slots, wake all of them
+    producer_parking_.notify_all<Wait>();
+  }
+
+  std::optional<T> pop_until_impl(Deadline deadline, const std::stop_token& stop) {
+    for (;;) {
+      std::uint64_t pos = tail_.load(std::memory_order_relaxed);
+      Cell& cell        = storage_[pos];
+      if (readable(cell, pos)) {
+        T item = std::move(*cell.get());
+        std::destroy_at(cell.get());
+        finish_read(pos, 1);
+        return item;
+      }
+      if (!consumer_parking_.wait<Wait>([&] { return readable(cell, pos); }, deadline, stop)) {
+        return std::nullopt;
+      }
+    }
+  }
+
+  // single threaded use only, every claimed counter below head_ has been written
+  void destroy_all() {
+    if constexpr (!std::is_trivially_destructible_v<T>) {
+      if (storage_.data() != nullptr) {  // moved from
+        for (std::uint64_t pos = tail_.load(); pos != head_.load(); ++pos) {
+          std::destroy_at(storage_[pos].get());
+        }
+      }
+    }
+  }
+
+  RingStorage<Cell, Capacity> storage_;  // slots and their sequence numbers
+
+  // producers, every push does an RMW here
+  alignas(kCacheLineSize) std::atomic<std::uint64_t> head_{0};  // Next counter to claim
+
+  // consumer, written on every pop
+  alignas(kCacheLineSize) std::atomic<std::uint64_t> tail_{0};  // Next counter to pop
+
+  // only written by a thread that parks, so both sides can keep reading them
+  alignas(kCacheLineSize) ParkingSpot consumer_parking_;
+  ParkingSpot producer_parking_;  // producers waiting for a full ring
+};
@@ -0,0 +1,121 @@
+// Copyright 2025 Chuangye Liu <chuangyeliu0206@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <stop_token>
+
+#include "Futex.hpp"
+#include "WaitStrategy.hpp"
+
+// Where the threads on one side of a queue idle until the other side makes progress.
+//
+// Waking a parked thread is a syscall, so the other side only notifies when a thread
+// has announced that it is about to sleep. The seq_cst fences pair up: either the
+// sleeper sees the progress, or the notifier sees the announcement.
+//
+// A parked thread sleeps on a 32-bit epoch rather than on the queue's index, a futex
+// can only wait on 32 bits but it can time out. The sleeper reads the epoch before its
+// last look at the queue, the notifier bumps it before the wake-up, so a wake-up that
+// races with going to sleep makes the futex return straight away.
+class ParkingSpot {
+public:
+  // call after publishing progress, wakes one parked thread if there is any
+  void notify_one() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiting_.load(std::memory_order_relaxed) != 0) {
+      epoch_.fetch_add(1, std::memory_order_release);
+      futex_wake_one(epoch_);
+    }
+  }
+
+  // same, for spots where the parked threads wait for different things
+  void notify_all() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiting_.load(std::memory_order_relaxed) != 0) {
+      wake_all();
+    }
+  }
+
+  // the same for a spot whose threads idle the way Wait says, nothing at all when
+  // Wait never parks
+  template <typename Wait>
+  void notify_one() {
+    if constexpr (kMayPark<Wait>) {
+      notify_one();
+    }
+  }
+
+  template <typename Wait>
+  void notify_all() {
+    if constexpr (kMayPark<Wait>) {
+      notify_all();
+    }
+  }
+
+  // Idles the way Wait (see WaitStrategy.hpp) says until ready() holds. Returns false
+  // if the deadline passes or stop is requested first.
+  template <typename Wait, typename Ready>
+  bool wait(Ready&& ready, Deadline deadline = Deadline::max(), const std::stop_token& stop = {}) {
+    Wait wait;
+    for (unsigned i = 0; !ready(); ++i) {
+      if (stop.stop_requested()
+          || (deadline != Deadline::max() && std::chrono::steady_clock::now() >= deadline)) {
+        return false;
+      }
+      if (!wait.idle(i)) {
+        return park(ready, deadline, stop);
+      }
+    }
+    return true;
+  }
+
+private:
+  template <typename Ready>
+  bool park(Ready& ready, Deadline deadline, const std::stop_token& stop) {
+    // stop_callback runs on the thread calling request_stop() and kicks us out of the futex
+    auto kick = [this] { wake_all(); };
+    std::optional<std::stop_callback<decltype(kick)>> on_stop;
+    if (stop.stop_possible()) {
+      on_stop.emplace(stop, kick);
+    }
+    bool is_ready = true;
+    waiting_.fetch_add(1, std::memory_order_relaxed);
+    for (;;) {
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      std::uint32_t epoch = epoch_.load(std::memory_order_acquire);
+      if (ready()) {
+        break;
+      }
+      if (stop.stop_requested() || !futex_wait_until(epoch_, epoch, deadline)) {
+        is_ready = ready();
+        break;
+      }
+    }
+    waiting_.fetch_sub(1, std::memory_order_relaxed);
+    return is_ready;
+  }
+
+  void wake_all() {
+    epoch_.fetch_add(1, std::memory_order_release);
+    futex_wake_all(epoch_);
+  }
+
+  std::atomic<std::uint32_t> waiting_{0};  // threads that are parked or about to park
+  std::atomic<std::uint32_t> epoch_{0};    // futex word the parked threads sleep on
+};
@@ -14,142 +14,573 @@
 
 #pragma once
 
+#include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <concepts>
+#include <cstdint>
+#include <cstring>
+#include <limits>
 #include <memory>
+#include <optional>
+#include <span>
+#include <stop_token>
+#include <thread>
+#include <type_traits>
+#include <utility>
 
+#include "CacheLine.hpp"
+#include "Futex.hpp"
+#include "Parking.hpp"
 #include "RingIterator.hpp"
+#include "RingStorage.hpp"
+#include "TimedPop.hpp"
+#include "WaitStrategy.hpp"
 
-template <typename T>
-concept SharedPtr = requires(T t) {
-  typename T::element_type;  //
-  requires std::same_as<T, std::shared_ptr<typename T::element_type>>;
-};
+// What push() does when the ring is full. try_push(), push_n() and reserve() never
+// overwrite and simply report a full ring, whatever the policy.
+struct OverwriteOldest {};  // discard the oldest element, for telemetry-like streams
+struct DropNewest {};       // discard the element being pushed and count it
+struct BlockWhenFull {};    // wait until the consumer frees a slot, i.e. backpressure
 
 // single producer-single consumer ring buffer
-// currently only support POD data structre and shared_ptr
-template <typename T>
-class RingBuffer {
+//
+// Slots are raw storage: an element is constructed in place when it is pushed and
+// destroyed as soon as it is popped, so T only has to be move constructible.
+//
+// head_ and tail_ are free running counters, the ring holds head_ - tail_ elements
+// and Capacity (see RingStorage.hpp) maps a counter onto its slot. Wait (see
+// WaitStrategy.hpp) decides how pop() and a BlockWhenFull push() idle.
+//
+// A full ring applies backpressure by default, the other policies are opt-in. With
+// OverwriteOldest the producer has to take elements away from the consumer, so tail_
+// becomes a claim cursor that both sides advance with a CAS: whoever wins owns the
+// element. That CAS is paid on every pop, which is why it is not the default. The
+// consumer publishes released_ once it is done with a claimed slot and the producer
+// never writes to a slot before it has been released.
+template <typename T, typename Capacity = DynamicCapacity, typename Overflow = BlockWhenFull,
+          typename Wait = Park>
+class RingBuffer : public TimedPop<RingBuffer<T, Capacity, Overflow, Wait>, T> {
+  friend TimedPop<RingBuffer, T>;
+
+  static constexpr bool kOverwrite = std::same_as<Overflow, OverwriteOldest>;
+
+  // inline slots are moved element by element, heap ones are handed over
+  static constexpr bool kNothrowMove =
+      !RingStorage<T, Capacity>::kInline || std::is_nothrow_move_constructible_v<T>;
+
 public:
   using BufferElement = T;
 
   // Old -> New
-  using iterator       = RingIterator<RingBuffer<T>, false, false>;
-  using const_iterator = RingIterator<RingBuffer<T>, true, false>;
+  using iterator       = RingIterator<RingBuffer, false, false>;
+  using const_iterator = RingIterator<RingBuffer, true, false>;
 
   // New -> Old
-  using reverse_iterator       = RingIterator<RingBuffer<T>, false, true>;
-  using const_reverse_iterator = RingIterator<RingBuffer<T>, true, true>;
+  using reverse_iterator       = RingIterator<RingBuffer, false, true>;
+  using const_reverse_iterator = RingIterator<RingBuffer, true, true>;
 
   explicit RingBuffer(size_t capacity = 128)
-      : capacity_(capacity + 1), buffer_(std::make_unique<T[]>(capacity + 1)), head_(0), tail_(0) {}
+    requires std::constructible_from<RingStorage<T, Capacity>, size_t>
+      : storage_(capacity) {}
 
-  RingBuffer(RingBuffer&& other) noexcept
-      : capacity_(other.capacity_),
-        buffer_(std::move(other.buffer_)),
-        head_(other.head_.load()),
-        tail_(other.tail_.load()) {}
+  // compile time capacity, constexpr so that a ring with static storage duration
+  // is constant initialized
+  constexpr RingBuffer()
+    requires std::default_initializable<RingStorage<T, Capacity>>
+      : storage_() {}
 
-  RingBuffer& operator=(RingBuffer&& other) noexcept {
+  RingBuffer(RingBuffer&& other) noexcept(kNothrowMove) : storage_(std::move(other.storage_)) {
+    take(other);
+  }
+
+  RingBuffer& operator=(RingBuffer&& other) noexcept(kNothrowMove) {
     if (this != &other) {
-      capacity_ = other.capacity_;
-      buffer_   = std::move(other.buffer_);
-      head_.store(other.head_.load());
-      tail_.store(other.tail_.load());
+      destroy_all();
+      storage_ = std::move(other.storage_);
+      take(other);
     }
     return *this;
   }
 
+  ~RingBuffer() { destroy_all(); }
+
   RingBuffer(const RingBuffer&)            = delete;
   RingBuffer& operator=(const RingBuffer&) = delete;
 
+  // pushes an element, a full ring is handled according to Overflow
   template <typename U>
     requires std::is_convertible_v<U&&, T>
   void push(U&& item) {
-    size_t current_head = head_.load(std::memory_order_relaxed);
-    size_t current_tail = tail_.load(std::memory_order_acquire);
-    size_t next_head    = (current_head + 1) % capacity_;
-    if (next_head == current_tail) {
-      if constexpr (SharedPtr<T>) {  // TODO: reduce redundancy
-        buffer_[current_tail].reset();
+    emplace(std::forward<U>(item));
+  }
+
+  // pushes an element unless the ring is full
+  template <typename U>
+    requires std::is_convertible_v<U&&, T>
+  bool try_push(U&& item) {
+    return try_emplace(std::forward<U>(item));
+  }
+
+  // constructs an element from args directly in its slot, a full ring is handled
+  // according to Overflow (with DropNewest nothing is constructed)
+  template <typename... Args>
+    requires std::constructible_from<T, Args&&...>
+  void emplace(Args&&... args) {
+    discard_reservation();
+    std::uint64_t current_head = head_.load(std::memory_order_relaxed);
+    if (free_slots(current_head, 1) == 0) {
+      if constexpr (std::same_as<Overflow, DropNewest>) {
+        dropped_.store(dropped_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return;
+      } else if constexpr (std::same_as<Overflow, BlockWhenFull>) {
+        wait_for_space(current_head);
+      } else {
+        drop_oldest(current_head);
       }
-      current_tail = (current_tail + 1) % capacity_;
-      tail_.store(current_tail, std::memory_order_release);
     }
-    buffer_[current_head] = std::forward<U>(item);
-    head_.store(next_head, std::memory_order_release);
-    head_.notify_one();
-    return;
+    std::construct_at(&storage_[current_head], std::forward<Args>(args)...);
+    publish(current_head + 1);
   }
 
-  T pop() {
-    size_t current_tail = tail_.load(std::memory_order_acquire);
-    head_.wait(current_tail, std::memory_order_acquire);
-    T item = std::move(buffer_[current_tail]);
-    if constexpr (SharedPtr<T>) {
-      buffer_[current_tail].reset();
+  // constructs an element from args directly in its slot unless the ring is full
+  template <typename... Args>
+    requires std::constructible_from<T, Args&&...>
+  bool try_emplace(Args&&... args) {
+    discard_reservation();
+    std::uint64_t current_head = head_.load(std::memory_order_relaxed);
+    if (free_slots(current_head, 1) == 0) {
+      return false;
     }
-    tail_.store((current_tail + 1) % capacity_, std::memory_order_release);
-    return item;
+    std::construct_at(&storage_[current_head], std::forward<Args>(args)...);
+    publish(current_head + 1);
+    return true;
   }
 
   bool try_pop(T& item) {
-    size_t current_tail = tail_.load(std::memory_order_acquire);
-    if (current_tail == head_.load(std::memory_order_acquire)) {
+    auto [first, n] = acquire_readable(1);
+    if (n == 0) {
       return false;
     }
-    item = std::move(buffer_[current_tail]);
-    if constexpr (SharedPtr<T>) {  // TODO: reduce redundancy
-      buffer_[current_tail].reset();
-    }
-    tail_.store((current_tail + 1) % capacity_, std::memory_order_release);
+    item = std::move(storage_[first]);
+    std::destroy_at(&storage_[first]);
+    finish_read(first, 1);
     return true;
   }
 
-  size_t size() const {
-    return (head_.load(std::memory_order_relaxed) - tail_.load(std::memory_order_relaxed)
-            + capacity_)
-           % capacity_;
+  // Pushes as many elements of items as there are free slots and returns that count,
+  // unlike push() it never overwrites. Elements of a non-const span are moved from.
+  // head_ is published once for the whole batch.
+  template <typename U>
+    requires std::same_as<std::remove_const_t<U>, T>
+  size_t push_n(std::span<U> items) {
+    discard_reservation();
+    std::uint64_t current_head = head_.load(std::memory_order_relaxed);
+    size_t n                   = std::min(items.size(), free_slots(current_head, items.size()));
+    if (n == 0) {
+      return 0;
+    }
+    // [first, capacity) and then [0, n - first) when the batch wraps around
+    size_t index = storage_.index(current_head);
+    size_t first = std::min(n, storage_.capacity() - index);
+    construct_n(storage_.data() + index, items.data(), first);
+    construct_n(storage_.data(), items.data() + first, n - first);
+    publish(current_head + n);
+    return n;
   }
 
-  bool empty() const {
-    return head_.load(std::memory_order_relaxed) == tail_.load(std::memory_order_relaxed);
+  // Moves up to out.size() elements into out and returns that count.
+  // The consumer index is published once for the whole batch.
+  size_t try_pop_n(std::span<T> out) {
+    auto [current_tail, n] = acquire_readable(out.size());
+    if (n == 0) {
+      return 0;
+    }
+    size_t index = storage_.index(current_tail);
+    size_t first = std::min(n, storage_.capacity() - index);
+    move_out_n(out.data(), storage_.data() + index, first);
+    move_out_n(out.data() + first, storage_.data(), n - first);
+    finish_read(current_tail, n);
+    return n;
   }
 
-  iterator begin() { return iterator(this, tail_.load(), 0); }
-
-  iterator end() { return iterator(this, head_.load(), this->size()); }
+  // Calls f(T&) on up to max elements in place, oldest first, and destroys each one
+  // afterwards. The consumer index is published once for the whole batch. If f throws,
+  // the elements before the one it threw on are consumed and that one stays queued.
+  template <typename F>
+  size_t drain(F&& f, size_t max = std::numeric_limits<size_t>::max()) {
+    auto [current_tail, n] = acquire_readable(max);
+    if (n == 0) {
+      return 0;
+    }
+    size_t done = 0;
+    // publishes what has been destroyed, also while unwinding
+    struct Finish {
+      RingBuffer* ring;
+      std::uint64_t first;
+      const size_t& done;
+      ~Finish() { ring->finish_read(first, done); }
+    } finish{this, current_tail, done};
+    for (; done < n; ++done) {
+      T& item = storage_[current_tail + done];
+      f(item);
+      std::destroy_at(&item);
+    }
+    return n;
+  }
 
-  const_iterator cbegin() const { return const_iterator(this, tail_.load(), 0); }
+  // Zero-copy producer side: returns up to n free slots that are contiguous in memory,
+  // empty when the ring is full. The caller writes into them and publishes the first
+  // k with commit(k). Never overwrites. The slots hold default-initialized elements,
+  // any other producer call drops whatever was reserved but not committed.
+  std::span<T> reserve(size_t n = 1)
+    requires std::default_initializable<T>
+  {
+    std::uint64_t current_head = head_.load(std::memory_order_relaxed);
+    size_t free                = free_slots(current_head, n);
+    size_t index               = storage_.index(current_head);
+    size_t count               = std::min({n, free, storage_.capacity() - index});
+    // the first reserved_ of them are still there from an earlier reserve()
+    for (size_t i = reserved_; i < count; ++i) {
+      ::new (static_cast<void*>(storage_.data() + index + i)) T;
+    }
+    reserved_ = std::max(reserved_, count);
+    return {storage_.data() + index, count};
+  }
 
-  const_iterator cend() const { return const_iterator(this, head_.load(), this->size()); }
+  void commit(size_t n = 1) {
+    reserved_ -= n;
+    publish(head_.load(std::memory_order_relaxed) + n);
+  }
 
-  reverse_iterator rbegin() {
-    return reverse_iterator(this, (head_.load() + capacity_ - 1) % capacity_, 0);
+  // Zero-copy consumer side: returns up to n readable elements that are contiguous in
+  // memory, empty when the ring is empty. The caller processes them in place and hands
+  // the first k back with release(k). With OverwriteOldest the returned elements are
+  // claimed, the producer cannot drop them until they are released.
+  std::span<const T> peek(size_t n = 1) {
+    auto [current_tail, available] = acquire_readable(n);
+    size_t index                   = storage_.index(current_tail);
+    return {storage_.data() + index, std::min(available, storage_.capacity() - index)};
   }
 
-  reverse_iterator rend() {
-    return reverse_iterator(this, (tail_.load() + 1) % capacity_, this->size());
+  void release(size_t n = 1) {
+    std::uint64_t current_tail = read_position();
+    for (size_t i = 0; i < n; ++i) {
+      std::destroy_at(&storage_[current_tail + i]);
+    }
+    finish_read(current_tail, n);
   }
 
-  const_reverse_iterator crbegin() const {
-    return const_reverse_iterator(this, (head_.load() + capacity_ - 1) % capacity_, 0);
+  // elements the consumer can still pop, including ones it has claimed (OverwriteOldest)
+  size_t size() const {
+    size_t claimed = claimed_unread();
+    // tail_ first, so that the head_ we read afterwards is never behind it
+    std::uint64_t current_tail = tail_.load(std::memory_order_acquire);
+    std::uint64_t current_head = head_.load(std::memory_order_relaxed);
+    return std::min<size_t>(current_head - current_tail + claimed, storage_.capacity());
   }
 
-  const_reverse_iterator crend() const {
-    return const_reverse_iterator(this, (tail_.load() + 1) % capacity_, this->size());
+  bool empty() const {
+    return claimed_unread() == 0
+           && head_.load(std::memory_order_relaxed) == tail_.load(std::memory_order_relaxed);
   }
 
+  size_t capacity() const { return storage_.capacity(); }
+
+  // number of elements lost because the ring was full (DropNewest and OverwriteOldest)
+  size_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+  iterator begin() { return iterator(this, tail_.load()); }
+
+  iterator end() { return iterator(this, head_.load()); }
+
+  const_iterator cbegin() const { return const_iterator(this, tail_.load()); }
+
+  const_iterator cend() const { return const_iterator(this, head_.load()); }
+
+  reverse_iterator rbegin() { return reverse_iterator(this, head_.load() - 1); }
+
+  reverse_iterator rend() { return reverse_iterator(this, tail_.load() - 1); }
+
+  const_reverse_iterator crbegin() const { return const_reverse_iterator(this, head_.load() - 1); }
+
+  const_reverse_iterator crend() const { return const_reverse_iterator(this, tail_.load() - 1); }
+
 private:
   template <typename, bool, bool>
   friend class RingIterator;
 
-  T* data() { return buffer_.get(); }
+  // constructs a contiguous segment of slots from src, moving when src is mutable
+  template <typename U>
+  static void construct_n(T* dst, U* src, size_t n) {
+    if constexpr (std::is_trivially_copyable_v<T>) {
+      if (n != 0) {
+        std::memcpy(dst, src, n * sizeof(T));
+      }
+    } else if constexpr (std::is_const_v<U>) {
+      std::uninitialized_copy_n(src, n, dst);
+    } else {
+      std::uninitialized_move_n(src, n, dst);
+    }
+  }
+
+  // moves a contiguous segment of slots into dst and ends the lifetime of the slots
+  static void move_out_n(T* dst, T* src, size_t n) {
+    if constexpr (std::is_trivially_copyable_v<T>) {
+      if (n != 0) {
+        std::memcpy(dst, src, n * sizeof(T));
+      }
+    } else {
+      std::move(src, src + n, dst);
+      std::destroy_n(src, n);
+    }
+  }
 
-  const T* data() const { return buffer_.get(); }
+  // calls f with the counter of every constructed slot, single threaded use only
+  template <typename F>
+  void for_each_constructed(F&& f) {
+    if constexpr (kOverwrite) {
+      for (std::uint64_t seq = read_, end = claimed_.load(); seq != end; ++seq) {
+        f(seq);
+      }
+    }
+    std::uint64_t end = head_.load() + reserved_;
+    for (std::uint64_t seq = tail_.load(); seq != end; ++seq) {
+      f(seq);
+    }
+  }
+
+  void destroy_all() {
+    if constexpr (!std::is_trivially_destructible_v<T>) {
+      if (storage_.data() != nullptr) {  // moved from
+        for_each_constructed([this](std::uint64_t seq) { std::destroy_at(&storage_[seq]); });
+      }
+    }
+  }
+
+  // takes over the state of other, whose storage_ has just been moved into ours
+  void take(RingBuffer& other) {
+    head_.store(other.head_.load());
+    cached_tail_ = other.cached_tail_;
+    reserved_    = other.reserved_;
+    dropped_.store(other.dropped_.load());
+    tail_.store(other.tail_.load());
+    released_.store(other.released_.load());
+    cached_head_ = other.cached_head_;
+    read_        = other.read_;
+    claimed_.store(other.claimed_.load());
+    if constexpr (RingStorage<T, Capacity>::kInline) {
+      // Inline slots cannot be stolen, the elements are moved one by one and the
+      // originals only destroyed once all are across. A move that throws leaves other
+      // as it was and this ring empty.
+      size_t moved = 0;
+      struct Undo {
+        RingBuffer* ring;
+        const size_t& moved;
+        ~Undo() {
+          if (ring != nullptr) {
+            size_t n = moved;
+            ring->for_each_constructed([&](std::uint64_t seq) {
+              if (n != 0) {
+                --n;
+                std::destroy_at(&ring->storage_[seq]);
+              }
+            });
+            ring->forget_all();
+          }
+        }
+      } undo{this, moved};
+      other.for_each_constructed([&](std::uint64_t seq) {
+        std::construct_at(&storage_[seq], std::move(other.storage_[seq]));
+        ++moved;
+      });
+      undo.ring = nullptr;
+      other.for_each_constructed([&](std::uint64_t seq) { std::destroy_at(&other.storage_[seq]); });
+      other.forget_all();
+    }
+  }
+
+  // empties the ring without destroying its elements, single threaded use only
+  void forget_all() {
+    tail_.store(head_.load());
+    released_.store(head_.load());
+    reserved_ = 0;
+    read_     = head_.load();
+    claimed_.store(read_);
+  }
+
+  // producer: ends the lifetime of slots reserved but never committed
+  void discard_reservation() {
+    if (reserved_ != 0) {
+      std::destroy_n(storage_.data() + storage_.index(head_.load(std::memory_order_relaxed)),
+                     reserved_);
+      reserved_ = 0;
+    }
+  }
+
+  T& slot(std::uint64_t seq) { return storage_[seq]; }
+
+  const T& slot(std::uint64_t seq) const { return storage_[seq]; }
+
+  // the index below which the consumer no longer touches any slot
+  std::atomic<std::uint64_t>& released() {
+    if constexpr (kOverwrite) {
+      return released_;
+    } else {
+      return tail_;
+    }
+  }
+
+  // producer: number of slots writable from current_head without overwriting,
+  // the consumer's index is only reloaded when fewer than wanted seem to be free
+  size_t free_slots(std::uint64_t current_head, size_t wanted) {
+    auto free = [&] {
+      size_t used = current_head - cached_tail_;
+      return used < storage_.capacity() ? storage_.capacity() - used : 0;
+    };
+    if (free() < wanted) {
+      cached_tail_ = released().load(std::memory_order_acquire);
+    }
+    return free();
+  }
+
+  // each side only pays for a wake-up when the other one is parked, see Parking.hpp
+  void publish(std::uint64_t next_head) {
+    head_.store(next_head, std::memory_order_release);
+    consumer_parking_.notify_one<Wait>();
+  }
+
+  std::optional<T> pop_until_impl(Deadline deadline, const std::stop_token& stop) {
+    for (;;) {
+      auto [first, n] = acquire_readable(1);
+      if (n != 0) {
+        T item = std::move(storage_[first]);
+        std::destroy_at(&storage_[first]);
+        finish_read(first, 1);
+        return item;
+      }
+      auto has_data = [&] { return head_.load(std::memory_order_acquire) != first; };
+      if (!consumer_parking_.wait<Wait>(has_data, deadline, stop)) {
+        return std::nullopt;
+      }
+    }
+  }
+
+  // BlockWhenFull: idles until the consumer has released the slot of current_head
+  void wait_for_space(std::uint64_t current_head) {
+    producer_parking_.wait<Wait>([&] { return free_slots(current_head, 1) != 0; });
+  }
+
+  // OverwriteOldest: makes room for current_head by taking the oldest element away from
+  // the consumer. If the consumer has already claimed it we have to let it finish.
+  void drop_oldest(std::uint64_t current_head) {
+    std::uint64_t oldest = current_head - storage_.capacity();
+    if (tail_.compare_exchange_strong(oldest, oldest + 1, std::memory_order_acq_rel,
+                                      std::memory_order_acquire)) {
+      dropped_.store(dropped_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      std::destroy_at(&storage_[oldest]);
+      return;
+    }
+    while (free_slots(current_head, 1) == 0) {
+      std::this_thread::yield();
+    }
+  }
+
+  // consumer: number of elements published after current_tail, at most wanted
+  size_t readable(std::uint64_t current_tail, size_t wanted) {
+    auto available = [&] { return cached_head_ > current_tail ? cached_head_ - current_tail : 0; };
+    if (available() < wanted) {
+      // only look at the producer's index when fewer than wanted seem to be there
+      cached_head_ = head_.load(std::memory_order_acquire);
+    }
+    return std::min<size_t>(available(), wanted);
+  }
+
+  std::uint64_t read_position() const {
+    if constexpr (kOverwrite) {
+      return read_;
+    } else {
+      return tail_.load(std::memory_order_relaxed);
+    }
+  }
+
+  // OverwriteOldest: elements the consumer has claimed but not read yet
+  size_t claimed_unread() const {
+    if constexpr (kOverwrite) {
+      // released_ first, claimed_ is never behind the one it was published after
+      std::uint64_t released = released_.load(std::memory_order_acquire);
+      return claimed_.load(std::memory_order_relaxed) - released;
+    } else {
+      return 0;
+    }
+  }
+
+  // consumer: returns the first readable counter and how many (at most wanted)
+  // elements from there on belong to the consumer
+  std::pair<std::uint64_t, size_t> acquire_readable(size_t wanted) {
+    if constexpr (kOverwrite) {
+      if (read_ == claimed_.load(std::memory_order_relaxed)) {
+        std::uint64_t current_tail = tail_.load(std::memory_order_acquire);
+        for (;;) {
+          size_t n = readable(current_tail, wanted);
+          if (n == 0) {
+            return {current_tail, 0};
+          }
+          // fails when the producer has dropped current_tail in the meantime
+          if (tail_.compare_exchange_weak(current_tail, current_tail + n,
+                                          std::memory_order_acq_rel, std::memory_order_acquire)) {
+            claimed_.store(current_tail + n, std::memory_order_relaxed);
+            if (current_tail != read_) {
+              // the producer dropped what was in between, nothing below is read any more
+              released_.store(current_tail, std::memory_order_release);
+            }
+            read_ = current_tail;
+            break;
+          }
+        }
+      }
+      return {read_, std::min<size_t>(claimed_.load(std::memory_order_relaxed) - read_, wanted)};
+    } else {
+      std::uint64_t current_tail = tail_.load(std::memory_order_relaxed);
+      return {current_tail, readable(current_tail, wanted)};
+    }
+  }
+
+  // consumer: hands [first, first + n) back to the producer
+  void finish_read(std::uint64_t first, size_t n) {
+    if constexpr (kOverwrite) {
+      read_ = first + n;
+      released_.store(read_, std::memory_order_release);
+    } else {
+      tail_.store(first + n, std::memory_order_release);
+      if constexpr (std::same_as<Overflow, BlockWhenFull>) {
+        producer_parking_.notify_one<Wait>();
+      }
+    }
+  }
+
+  RingStorage<T, Capacity> storage_;  // The actual ring buffer
+
+  // producer side, written on every push
+  alignas(kCacheLineSize) std::atomic<std::uint64_t> head_{0};  // Next counter to push
+  std::uint64_t cached_tail_ = 0;  // producer's copy of released(), refreshed when the ring looks full
+  size_t reserved_           = 0;  // slots from head_ on constructed by reserve() but not committed
+  std::atomic<std::uint64_t> dropped_{0};  // elements lost to Overflow, written by the producer only
+
+  // consumer side, written on every pop
+  alignas(kCacheLineSize) std::atomic<std::uint64_t> tail_{0};  // Next counter to pop
+  std::uint64_t cached_head_ = 0;  // consumer's copy of head_, refreshed when the ring looks empty
+  // OverwriteOldest, written by the consumer only: slots below released_ are no longer
+  // read, [read_, claimed_) are claimed and not read yet
+  std::atomic<std::uint64_t> released_{0};
+  std::atomic<std::uint64_t> claimed_{0};
+  std::uint64_t read_ = 0;
+
+  // only written by a thread that parks, so both sides can keep reading them
+  alignas(kCacheLineSize) ParkingSpot consumer_parking_;
+  ParkingSpot producer_parking_;  // BlockWhenFull only
+};
 
-  const size_t capacity_;
-  std::unique_ptr<T[]> buffer_;  // The actual ring buffer
-  std::atomic<size_t> head_;     // Points to the next available spot for push
-  std::atomic<size_t> tail_;     // Points to the next spot to pop
-};
\ No newline at end of file
+// fixed capacity ring buffer with inline storage, e.g. for static or shared memory
+template <typename T, size_t N>
+using StaticRingBuffer = RingBuffer<T, FixedCapacity<N>>;
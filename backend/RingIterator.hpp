@@ -14,6 +14,9 @@
 
 #pragma once
 
+#include <cstdint>
+#include <iterator>
+
 template <class RingBufferType, bool IsConst = false, bool IsReverse = false>
 class RingIterator {
 public:
@@ -25,29 +28,27 @@ public:
 
   using RingBufferPtr = std::conditional_t<IsConst, const RingBufferType*, RingBufferType*>;
 
-  RingIterator(RingBufferPtr owner, size_t pos, size_t count)
-      : owner_(owner), pos_(pos), count_(count) {}
+  // pos is a free running counter of the owner, the owner maps it onto a slot
+  RingIterator(RingBufferPtr owner, std::uint64_t pos) : owner_(owner), pos_(pos) {}
 
-  reference operator*() const { return owner_->data()[pos_]; }
+  reference operator*() const { return owner_->slot(pos_); }
 
   pointer operator->() const { return &(operator*()); }
 
   RingIterator& operator++() {
     if constexpr (IsReverse) {
-      pos_ = (pos_ + owner_->capacity_ - 1) % owner_->capacity_;
+      --pos_;
     } else {
-      pos_ = (pos_ + 1) % owner_->capacity_;
+      ++pos_;
     }
-    ++count_;
     return *this;
   }
 
-  bool operator==(const RingIterator& other) const { return count_ == other.count_; }
+  bool operator==(const RingIterator& other) const { return pos_ == other.pos_; }
 
   bool operator!=(const RingIterator& other) const { return !(*this == other); }
 
 private:
   RingBufferPtr owner_;
-  size_t pos_;
-  size_t count_;
+  std::uint64_t pos_;
 };
@@ -0,0 +1,144 @@
+// Copyright 2025 Chuangye Liu <chuangyeliu0206@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+#include "CacheLine.hpp"
+
+// Capacity policies of RingBuffer. The ring keeps free running 64-bit head/tail
+// counters and the policy decides how a counter is mapped onto a slot.
+//
+// The storage only provides raw memory, RingBuffer constructs and destroys the
+// elements in it.
+
+// any capacity, slot = counter % capacity
+struct DynamicCapacity {};
+
+// capacity is rounded up to a power of two, slot = counter & (capacity - 1)
+struct PowerOfTwoCapacity {};
+
+// capacity is a compile time constant and the slots are stored inline, no allocation
+template <size_t N>
+struct FixedCapacity {
+  static_assert(N > 0, "FixedCapacity needs at least one slot");
+};
+
+// uninitialized memory for one T
+template <typename T>
+struct alignas(T) RawSlot {
+  std::byte bytes[sizeof(T)];
+};
+
+// What a multi-producer ring can build in a slot it has claimed. A claimed slot must be
+// published or the consumers stall on it, so a constructor that may throw runs on a
+// temporary before the claim, and moving that in must not throw.
+template <typename T, typename... Args>
+concept ClaimConstructible = std::constructible_from<T, Args...>
+                             && (std::is_nothrow_constructible_v<T, Args...>
+                                 || std::is_nothrow_move_constructible_v<T>);
+
+template <typename T, typename Policy>
+class RingStorage;
+
+template <typename T>
+class RingStorage<T, DynamicCapacity> {
+public:
+  static constexpr bool kInline = false;
+
+  // allocation only, the memory is not touched
+  explicit RingStorage(size_t capacity)
+      : capacity_(std::max<size_t>(capacity, 1)),
+        buffer_(std::make_unique_for_overwrite<RawSlot<T>[]>(capacity_)) {}
+
+  T& operator[](std::uint64_t seq) { return data()[seq % capacity_]; }
+
+  const T& operator[](std::uint64_t seq) const { return data()[seq % capacity_]; }
+
+  size_t index(std::uint64_t seq) const { return seq % capacity_; }
+
+  T* data() { return reinterpret_cast<T*>(buffer_.get()); }
+
+  const T* data() const { return reinterpret_cast<const T*>(buffer_.get()); }
+
+  size_t capacity() const { return capacity_; }
+
+private:
+  size_t capacity_;
+  std::unique_ptr<RawSlot<T>[]> buffer_;
+};
+
+template <typename T>
+class RingStorage<T, PowerOfTwoCapacity> {
+public:
+  static constexpr bool kInline = false;
+
+  // allocation only, the memory is not touched
+  explicit RingStorage(size_t capacity)
+      : mask_(std::bit_ceil(std::max<size_t>(capacity, 1)) - 1),
+        buffer_(std::make_unique_for_overwrite<RawSlot<T>[]>(mask_ + 1)) {}
+
+  T& operator[](std::uint64_t seq) { return data()[seq & mask_]; }
+
+  const T& operator[](std::uint64_t seq) const { return data()[seq & mask_]; }
+
+  size_t index(std::uint64_t seq) const { return seq & mask_; }
+
+  T* data() { return reinterpret_cast<T*>(buffer_.get()); }
+
+  const T* data() const { return reinterpret_cast<const T*>(buffer_.get()); }
+
+  size_t capacity() const { return mask_ + 1; }
+
+private:
+  size_t mask_;
+  std::unique_ptr<RawSlot<T>[]> buffer_;
+};
+
+template <typename T, size_t N>
+class RingStorage<T, FixedCapacity<N>> {
+public:
+  // the slots cannot be handed over, RingBuffer moves the elements itself
+  static constexpr bool kInline = true;
+
+  // zeroed bytes rather than left uninitialized so that a ring with static storage
+  // duration can be constant initialized
+  constexpr RingStorage() : buffer_{} {}
+
+  RingStorage(RingStorage&&) noexcept {}
+
+  RingStorage& operator=(RingStorage&&) noexcept { return *this; }
+
+  T& operator[](std::uint64_t seq) { return data()[seq % N]; }
+
+  const T& operator[](std::uint64_t seq) const { return data()[seq % N]; }
+
+  static constexpr size_t index(std::uint64_t seq) { return seq % N; }
+
+  T* data() { return reinterpret_cast<T*>(buffer_); }
+
+  const T* data() const { return reinterpret_cast<const T*>(buffer_); }
+
+  static constexpr size_t capacity() { return N; }
+
+private:
+  alignas(kCacheLineSize) RawSlot<T> buffer_[N];
+};
@@ -0,0 +1,68 @@
+// Copyright 2025 Chuangye Liu <chuangyeliu0206@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <chrono>
+#include <concepts>
+#include <optional>
+#include <stop_token>
+
+#include "Futex.hpp"
+
+// The blocking pops of a backend, written once on top of its
+//
+//   std::optional<T> pop_until_impl(Deadline deadline, const std::stop_token& stop);
+//
+// which waits until an element arrives, the deadline passes or stop is requested. Every
+// timeout and clock is turned into a steady_clock Deadline here. Derived befriends
+// TimedPop when pop_until_impl is private.
+template <typename Derived, typename T>
+class TimedPop {
+public:
+  T pop() { return *self().pop_until_impl(Deadline::max(), {}); }
+
+  // blocking pop that gives up after timeout
+  template <typename Rep, typename Period>
+  std::optional<T> pop_for(const std::chrono::duration<Rep, Period>& timeout) {
+    return self().pop_until_impl(
+        std::chrono::steady_clock::now()
+            + std::chrono::ceil<std::chrono::steady_clock::duration>(timeout),
+        {});
+  }
+
+  // blocking pop that gives up at deadline
+  template <typename Clock, typename Duration>
+  std::optional<T> pop_until(const std::chrono::time_point<Clock, Duration>& deadline) {
+    if constexpr (std::same_as<Clock, std::chrono::steady_clock>) {
+      return self().pop_until_impl(
+          std::chrono::ceil<std::chrono::steady_clock::duration>(deadline), {});
+    } else {
+      return pop_for(deadline - Clock::now());
+    }
+  }
+
+  // blocking pop that gives up once stop is requested
+  std::optional<T> pop(std::stop_token stop) {
+    return self().pop_until_impl(Deadline::max(), stop);
+  }
+
+  // both, for backends that wait in another one's pop
+  std::optional<T> pop_until(Deadline deadline, const std::stop_token& stop) {
+    return self().pop_until_impl(deadline, stop);
+  }
+
+private:
+  Derived& self() { return static_cast<Derived&>(*this); }
+};
@@ -0,0 +1,191 @@
+// Copyright 2025 Chuangye Liu <chuangyeliu0206@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <concepts>
+#include <cstdint>
+#include <optional>
+#include <stop_token>
+#include <type_traits>
+#include <utility>
+
+#include "CacheLine.hpp"
+#include "Futex.hpp"
+#include "Parking.hpp"
+#include "TimedPop.hpp"
+#include "WaitStrategy.hpp"
+
+// single producer-single consumer mailbox that only keeps the latest value, e.g. for
+// position snapshots or configuration: a value the consumer has not read yet is
+// replaced by the next one instead of queueing behind it
+//
+// Three slots: the producer writes into its back slot, the consumer reads its front
+// slot and the third one sits in the middle. Publishing swaps back and middle, taking
+// a new value swaps middle and front, each with one exchange on middle_, which also
+// carries a flag saying whether the middle slot holds a value the consumer has not
+// seen. Neither side ever waits for the other, except a consumer in pop() for a value
+// to arrive (see WaitStrategy.hpp).
+template <typename T, typename Wait = Park>
+class TripleBuffer : public TimedPop<TripleBuffer<T, Wait>, T> {
+  friend TimedPop<TripleBuffer, T>;
+
+  static constexpr std::uint8_t kIndex = 0b011;
+  static constexpr std::uint8_t kFresh = 0b100;  // middle slot holds an unseen value
+
+  struct alignas(kCacheLineSize) Slot {
+    std::optional<T> value;
+  };
+
+  // both moves move the slots' values over one by one
+  static constexpr bool kNothrowMove = std::is_nothrow_move_assignable_v<std::optional<T>>;
+
+public:
+  using BufferElement = T;
+
+  TripleBuffer() = default;
+
+  // single threaded use only
+  TripleBuffer(TripleBuffer&& other) noexcept(kNothrowMove)
+      : back_(other.back_),
+        conflated_(other.conflated_.load()),
+        middle_(other.middle_.load()),
+        front_(other.front_),
+        held_(other.held_.load()) {
+    for (int i = 0; i < 3; ++i) {
+      slots_[i].value = std::move(other.slots_[i].value);
+    }
+  }
+
+  TripleBuffer& operator=(TripleBuffer&& other) noexcept(kNothrowMove) {
+    if (this != &other) {
+      back_ = other.back_;
+      conflated_.store(other.conflated_.load());
+      middle_.store(other.middle_.load());
+      front_ = other.front_;
+      held_.store(other.held_.load());
+      for (int i = 0; i < 3; ++i) {
+        slots_[i].value = std::move(other.slots_[i].value);
+      }
+    }
+    return *this;
+  }
+
+  TripleBuffer(const TripleBuffer&)            = delete;
+  TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+  // publishes a value, replacing one the consumer has not taken yet
+  template <typename U>
+    requires std::is_convertible_v<U&&, T>
+  void push(U&& item) {
+    emplace(std::forward<U>(item));
+  }
+
+  // always succeeds, there for interchangeability with the rings
+  template <typename U>
+    requires std::is_convertible_v<U&&, T>
+  bool try_push(U&& item) {
+    emplace(std::forward<U>(item));
+    return true;
+  }
+
+  // constructs a value from args directly in the back slot and publishes it
+  template <typename... Args>
+    requires std::constructible_from<T, Args&&...>
+  void emplace(Args&&... args) {
+    slots_[back_].value.emplace(std::forward<Args>(args)...);
+    std::uint8_t old = middle_.exchange(back_ | kFresh, std::memory_order_acq_rel);
+    back_            = old & kIndex;
+    if (old & kFresh) {
+      conflated_.store(conflated_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+    consumer_parking_.notify_one<Wait>();
+  }
+
+  // whether a value arrived since the consumer last looked, cheap enough to poll
+  bool has_new() const { return middle_.load(std::memory_order_relaxed) & kFresh; }
+
+  // Consumer: the latest value without taking it, nullptr if there has been none since
+  // the last pop. Valid until the next consumer call.
+  const T* peek() {
+    refresh();
+    const std::optional<T>& value = slots_[front_].value;
+    return value ? &*value : nullptr;
+  }
+
+  // takes the latest value, false if there is none since the last pop
+  bool try_pop(T& item) {
+    refresh();
+    std::optional<T>& value = slots_[front_].value;
+    if (!value) {
+      return false;
+    }
+    item = std::move(*value);
+    value.reset();
+    held_.store(false, std::memory_order_relaxed);
+    return true;
+  }
+
+  // 1 while a value is waiting for the consumer, also one it peeked but did not pop
+  size_t size() const { return empty() ? 0 : 1; }
+
+  bool empty() const { return !has_new() && !held_.load(std::memory_order_relaxed); }
+
+  static constexpr size_t capacity() { return 1; }
+
+  // number of values replaced before the consumer took them
+  size_t conflated() const { return conflated_.load(std::memory_order_relaxed); }
+
+private:
+  // consumer: swaps a fresh middle slot in as the front
+  void refresh() {
+    if (has_new()) {
+      front_ = middle_.exchange(front_, std::memory_order_acq_rel) & kIndex;
+      held_.store(true, std::memory_order_relaxed);
+    }
+  }
+
+  std::optional<T> pop_until_impl(Deadline deadline, const std::stop_token& stop) {
+    for (;;) {
+      refresh();
+      if (std::optional<T>& value = slots_[front_].value; value) {
+        std::optional<T> item = std::move(value);
+        value.reset();
+        held_.store(false, std::memory_order_relaxed);
+        return item;
+      }
+      if (!consumer_parking_.wait<Wait>([this] { return has_new(); }, deadline, stop)) {
+        return std::nullopt;
+      }
+    }
+  }
+
+  Slot slots_[3];
+
+  // producer side, written on every push
+  alignas(kCacheLineSize) std::uint8_t back_ = 0;
+  std::atomic<size_t> conflated_{0};  // written by the producer only
+
+  // exchanged by both sides: index of the middle slot | kFresh
+  alignas(kCacheLineSize) std::atomic<std::uint8_t> middle_{1};
+
+  // consumer side
+  alignas(kCacheLineSize) std::uint8_t front_ = 2;
+  std::atomic<bool> held_{false};  // the front slot holds a value, written by the consumer only
+
+  // only written by a consumer that parks
+  alignas(kCacheLineSize) ParkingSpot consumer_parking_;
+};
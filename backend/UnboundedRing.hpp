@@ -0,0 +1,258 @@
+// Copyright 2025 Chuangye Liu <chuangyeliu0206@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <concepts>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <stop_token>
+#include <type_traits>
+#include <utility>
+
+#include "CacheLine.hpp"
+#include "Futex.hpp"
+#include "Parking.hpp"
+#include "RingBuf.hpp"
+#include "RingStorage.hpp"
+#include "TimedPop.hpp"
+#include "WaitStrategy.hpp"
+
+// memory use of an UnboundedRingBuffer, read by the producer or between the threads
+struct ChunkStats {
+  size_t chunks;           // chunks alive right now, including the cached ones
+  size_t peak_chunks;      // high-water mark of chunks
+  size_t peak_bytes;       // high-water mark of the memory held in chunks
+  size_t allocations;      // chunks allocated since construction
+};
+
+// unbounded single producer-single consumer queue, never drops and never blocks a push
+//
+// The elements live in a linked list of chunks of ChunkSize slots. head_ and tail_ are
+// free running counters like in RingBuffer, counter pos is slot pos % ChunkSize of its
+// chunk. The producer links a new chunk before it publishes the first element in it, the
+// consumer hands a chunk it has read to a small cache of free chunks (itself a ring)
+// where the producer picks it up again, so a consumer that keeps up means no allocation.
+// A burst allocates more chunks, which are freed again once the cache is full.
+template <typename T, size_t ChunkSize = 1024, typename Wait = Park>
+class UnboundedRingBuffer : public TimedPop<UnboundedRingBuffer<T, ChunkSize, Wait>, T> {
+  friend TimedPop<UnboundedRingBuffer, T>;
+
+  static_assert(std::has_single_bit(ChunkSize), "ChunkSize has to be a power of two");
+
+  struct Chunk {
+    T* slot(std::uint64_t pos) { return reinterpret_cast<T*>(&slots[pos & (ChunkSize - 1)]); }
+
+    RawSlot<T> slots[ChunkSize];
+    std::atomic<Chunk*> next{nullptr};
+  };
+
+  static constexpr size_t kCachedChunks = 4;
+
+public:
+  using BufferElement = T;
+
+  UnboundedRingBuffer() {
+    write_chunk_ = allocate();
+    read_chunk_  = write_chunk_;
+  }
+
+  UnboundedRingBuffer(UnboundedRingBuffer&& other) noexcept
+      : head_(other.head_.load()),
+        write_chunk_(std::exchange(other.write_chunk_, nullptr)),
+        allocations_(other.allocations_.load()),
+        peak_chunks_(other.peak_chunks_.load()),
+        tail_(other.tail_.load()),
+        read_chunk_(std::exchange(other.read_chunk_, nullptr)),
+        cached_head_(other.cached_head_),
+        frees_(other.frees_.load()),
+        free_(std::move(other.free_)) {}
+
+  UnboundedRingBuffer& operator=(UnboundedRingBuffer&& other) noexcept {
+    if (this != &other) {
+      release_all();
+      head_.store(other.head_.load());
+      write_chunk_ = std::exchange(other.write_chunk_, nullptr);
+      allocations_.store(other.allocations_.load());
+      peak_chunks_.store(other.peak_chunks_.load());
+      tail_.store(other.tail_.load());
+      read_chunk_  = std::exchange(other.read_chunk_, nullptr);
+      cached_head_ = other.cached_head_;
+      frees_.store(other.frees_.load());
+      free_ = std::move(other.free_);
+    }
+    return *this;
+  }
+
+  ~UnboundedRingBuffer() { release_all(); }
+
+  UnboundedRingBuffer(const UnboundedRingBuffer&)            = delete;
+  UnboundedRingBuffer& operator=(const UnboundedRingBuffer&) = delete;
+
+  template <typename U>
+    requires std::is_convertible_v<U&&, T>
+  void push(U&& item) {
+    emplace(std::forward<U>(item));
+  }
+
+  // always succeeds, there for interchangeability with the bounded rings
+  template <typename U>
+    requires std::is_convertible_v<U&&, T>
+  bool try_push(U&& item) {
+    emplace(std::forward<U>(item));
+    return true;
+  }
+
+  // constructs an element from args directly in its slot
+  template <typename... Args>
+    requires std::constructible_from<T, Args&&...>
+  void emplace(Args&&... args) {
+    std::uint64_t pos = head_.load(std::memory_order_relaxed);
+    if ((pos & (ChunkSize - 1)) == 0 && pos != 0) {
+      Chunk* chunk = nullptr;
+      if (!free_.try_pop(chunk)) {
+        chunk = allocate();
+      }
+      chunk->next.store(nullptr, std::memory_order_relaxed);
+      write_chunk_->next.store(chunk, std::memory_order_release);
+      write_chunk_ = chunk;
+    }
+    std::construct_at(write_chunk_->slot(pos), std::forward<Args>(args)...);
+    head_.store(pos + 1, std::memory_order_release);
+    consumer_parking_.notify_one<Wait>();
+  }
+
+  bool try_pop(T& item) {
+    std::uint64_t pos = tail_.load(std::memory_order_relaxed);
+    if (!readable(pos)) {
+      return false;
+    }
+    T* slot = enter_chunk(pos);
+    item    = std::move(*slot);
+    std::destroy_at(slot);
+    tail_.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  size_t size() const {
+    // tail_ first, so that the head_ we read afterwards is never behind it
+    std::uint64_t current_tail = tail_.load(std::memory_order_acquire);
+    return head_.load(std::memory_order_relaxed) - current_tail;
+  }
+
+  bool empty() const {
+    return head_.load(std::memory_order_relaxed) == tail_.load(std::memory_order_relaxed);
+  }
+
+  ChunkStats stats() const {
+    size_t allocations = allocations_.load(std::memory_order_relaxed);
+    size_t peak        = peak_chunks_.load(std::memory_order_relaxed);
+    return {allocations - frees_.load(std::memory_order_relaxed), peak, peak * sizeof(Chunk),
+            allocations};
+  }
+
+private:
+  // consumer: whether the element at pos has been published, head_ is only reloaded
+  // when the ring looks empty
+  bool readable(std::uint64_t pos) {
+    if (cached_head_ == pos) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+    }
+    return cached_head_ != pos;
+  }
+
+  // consumer: the slot of the published element at pos, moves on to the next chunk and
+  // recycles the one it leaves when pos is the first counter of a chunk
+  T* enter_chunk(std::uint64_t pos) {
+    if ((pos & (ChunkSize - 1)) == 0 && pos != 0) {
+      Chunk* done = std::exchange(read_chunk_, read_chunk_->next.load(std::memory_order_acquire));
+      if (!free_.try_push(done)) {
+        delete done;
+        frees_.store(frees_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      }
+    }
+    return read_chunk_->slot(pos);
+  }
+
+  // producer
+  Chunk* allocate() {
+    auto* chunk        = new Chunk;
+    size_t allocations = allocations_.load(std::memory_order_relaxed) + 1;
+    allocations_.store(allocations, std::memory_order_relaxed);
+    size_t alive = allocations - frees_.load(std::memory_order_relaxed);
+    if (alive > peak_chunks_.load(std::memory_order_relaxed)) {
+      peak_chunks_.store(alive, std::memory_order_relaxed);
+    }
+    return chunk;
+  }
+
+  std::optional<T> pop_until_impl(Deadline deadline, const std::stop_token& stop) {
+    for (;;) {
+      std::uint64_t pos = tail_.load(std::memory_order_relaxed);
+      if (readable(pos)) {
+        T* slot = enter_chunk(pos);
+        T item  = std::move(*slot);
+        std::destroy_at(slot);
+        tail_.store(pos + 1, std::memory_order_release);
+        return item;
+      }
+      auto has_data = [&] { return head_.load(std::memory_order_acquire) != pos; };
+      if (!consumer_parking_.wait<Wait>(has_data, deadline, stop)) {
+        return std::nullopt;
+      }
+    }
+  }
+
+  // single threaded use only
+  void release_all() {
+    if (read_chunk_ == nullptr) {  // moved from
+      return;
+    }
+    for (std::uint64_t pos = tail_.load(); pos != head_.load(); ++pos) {
+      std::destroy_at(enter_chunk(pos));
+    }
+    for (Chunk* chunk = read_chunk_; chunk != nullptr;) {
+      delete std::exchange(chunk, chunk->next.load());
+    }
+    Chunk* chunk = nullptr;
+    while (free_.try_pop(chunk)) {
+      delete chunk;
+    }
+    read_chunk_  = nullptr;
+    write_chunk_ = nullptr;
+  }
+
+  // producer side, written on every push
+  alignas(kCacheLineSize) std::atomic<std::uint64_t> head_{0};  // Next counter to push
+  Chunk* write_chunk_ = nullptr;             // chunk of head_, or the one before it
+  std::atomic<size_t> allocations_{0};       // written by the producer only
+  std::atomic<size_t> peak_chunks_{0};       // written by the producer only
+
+  // consumer side, written on every pop
+  alignas(kCacheLineSize) std::atomic<std::uint64_t> tail_{0};  // Next counter to pop
+  Chunk* read_chunk_ = nullptr;      // chunk of tail_, or the one before it
+  std::uint64_t cached_head_ = 0;    // consumer's copy of head_, refreshed when it looks empty
+  std::atomic<size_t> frees_{0};     // chunks deleted, written by the consumer only
+
+  // chunks the consumer is done with, it pushes and the producer pops
+  RingBuffer<Chunk*, FixedCapacity<kCachedChunks>, DropNewest, BusySpin> free_;
+
+  // only written by a consumer that parks
+  alignas(kCacheLineSize) ParkingSpot consumer_parking_;
+};
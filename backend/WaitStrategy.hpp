@@ -0,0 +1,100 @@
+// Copyright 2025 Chuangye Liu <chuangyeliu0206@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#  include <immintrin.h>
+#endif
+
+// tells the CPU we are in a spin loop, cheaper for the sibling hyperthread and for
+// the memory pipeline than a bare re-check
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+  _mm_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield" ::: "memory");
+#endif
+}
+
+// Wait strategies decide how a thread idles until the other side of a queue makes
+// progress. idle(iteration) is called after every failed check, iteration counts
+// from 0, and returns false once the caller should park on a futex instead of
+// checking again. kParks says whether it ever does: the other side only pays for
+// notifying (a seq_cst fence, see Parking.hpp) when it may.
+
+// never sleeps and never yields, for pinned consumers on an isolated core
+struct BusySpin {
+  static constexpr bool kParks = false;
+
+  bool idle(unsigned) { cpu_relax(); return true; }
+};
+
+// spins with exponentially growing pause bursts, capped at 2^MaxShift pauses
+template <unsigned MaxShift = 6>
+struct BackoffSpin {
+  static constexpr bool kParks = false;
+
+  bool idle(unsigned iteration) {
+    for (unsigned i = 0, n = 1u << std::min(iteration, MaxShift); i < n; ++i) {
+      cpu_relax();
+    }
+    return true;
+  }
+};
+
+// spins Spins times, then gives the core away with sched_yield on every check
+template <unsigned Spins = 100>
+struct SpinThenYield {
+  static constexpr bool kParks = false;
+
+  bool idle(unsigned iteration) {
+    if (iteration < Spins) {
+      cpu_relax();
+    } else {
+      std::this_thread::yield();
+    }
+    return true;
+  }
+};
+
+// spins Spins times, then parks until it is notified
+template <unsigned Spins = 100>
+struct SpinThenPark {
+  static constexpr bool kParks = true;
+
+  bool idle(unsigned iteration) {
+    if (iteration < Spins) {
+      cpu_relax();
+      return true;
+    }
+    return false;
+  }
+};
+
+// parks right away, for background threads that must not burn a core
+using Park = SpinThenPark<0>;
+
+// whether Wait may park, a strategy that does not say is assumed to
+template <typename Wait>
+inline constexpr bool kMayPark = [] {
+  if constexpr (requires { Wait::kParks; }) {
+    return Wait::kParks;
+  } else {
+    return true;
+  }
+}();
@@ -0,0 +1,85 @@
+// Cost per message of moving bursts through the type erased MsgQueue, one message per
+// virtual call against one virtual call (and one index publication) per burst.
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <span>
+
+#include "MsgQueue.hpp"
+#include "backend/RingBuf.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int kMessages = 4000000;
+constexpr int kBurst    = 256;
+
+// keeps the consumers from being optimized away
+static volatile long sink;
+
+static double ns_per_op(Clock::duration d, int ops) {
+  return std::chrono::duration<double, std::nano>(d).count() / ops;
+}
+
+static double one_by_one() {
+  MsgQueue mq(RingBuffer<int, PowerOfTwoCapacity>{kBurst});
+  int out;
+  long sum   = 0;
+  auto start = Clock::now();
+  for (int i = 0; i < kMessages; i += kBurst) {
+    for (int j = 0; j < kBurst; ++j) {
+      mq.enqueue(i + j);
+    }
+    while (mq.dequeue(out)) {
+      sum += out;
+    }
+  }
+  auto elapsed = Clock::now() - start;
+  sink = sum;
+  return ns_per_op(elapsed, kMessages);
+}
+
+static double batched() {
+  MsgQueue mq(RingBuffer<int, PowerOfTwoCapacity>{kBurst});
+  std::array<int, kBurst> burst;
+  std::array<int, kBurst> out;
+  long sum   = 0;
+  auto start = Clock::now();
+  for (int i = 0; i < kMessages; i += kBurst) {
+    for (int j = 0; j < kBurst; ++j) {
+      burst[j] = i + j;
+    }
+    mq.enqueue_n(std::span<const int>(burst));
+    size_t n = mq.dequeue_n(std::span<int>(out));
+    for (size_t j = 0; j < n; ++j) {
+      sum += out[j];
+    }
+  }
+  auto elapsed = Clock::now() - start;
+  sink = sum;
+  return ns_per_op(elapsed, kMessages);
+}
+
+static double drained() {
+  MsgQueue mq(RingBuffer<int, PowerOfTwoCapacity>{kBurst});
+  std::array<int, kBurst> burst;
+  long sum   = 0;
+  auto start = Clock::now();
+  for (int i = 0; i < kMessages; i += kBurst) {
+    for (int j = 0; j < kBurst; ++j) {
+      burst[j] = i + j;
+    }
+    mq.enqueue_n(std::span<const int>(burst));
+    mq.drain<int>([&sum](int& m) { sum += m; });
+  }
+  auto elapsed = Clock::now() - start;
+  sink = sum;
+  return ns_per_op(elapsed, kMessages);
+}
+
+int main() {
+  std::printf("enqueue/dequeue      : %8.2f ns/msg\n", one_by_one());
+  std::printf("enqueue_n/dequeue_n  : %8.2f ns/msg\n", batched());
+  std::printf("enqueue_n/drain      : %8.2f ns/msg\n", drained());
+  return 0;
+}
@@ -0,0 +1,97 @@
+// Fan-out of one stream of 64 byte ticks to 1 to 6 readers: one BroadcastRingBuffer that
+// every reader reads in place, against one RingBuffer per reader that the producer
+// copies every tick into.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "backend/BroadcastRing.hpp"
+#include "backend/RingBuf.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int kMessages = 2000000;
+constexpr size_t kSlots = 1024;
+
+struct Tick {
+  std::uint64_t seq;
+  double fields[7];
+};
+
+static volatile std::uint64_t sink;
+
+// throughput in million ticks per second
+static double run_broadcast(int readers) {
+  BroadcastRingBuffer<Tick, PowerOfTwoCapacity, BlockWhenFull, SpinThenYield<>> rb(kSlots,
+                                                                                 readers);
+  auto start = Clock::now();
+  std::vector<std::thread> threads;
+  for (int r = 0; r < readers; ++r) {
+    threads.emplace_back([&rb, r] {
+      auto reader       = rb.reader(r);
+      std::uint64_t sum = 0;
+      for (int n = 0; n < kMessages;) {
+        auto ticks = reader.peek(64);
+        if (ticks.empty()) {
+          std::this_thread::yield();
+          continue;
+        }
+        for (const Tick& tick : ticks) {
+          sum += tick.seq;
+        }
+        reader.release(ticks.size());
+        n += static_cast<int>(ticks.size());
+      }
+      sink = sum;
+    });
+  }
+  for (int i = 0; i < kMessages; ++i) {
+    rb.push(Tick{static_cast<std::uint64_t>(i), {}});
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  return kMessages / std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+}
+
+static double run_copies(int readers) {
+  std::vector<RingBuffer<Tick, PowerOfTwoCapacity, BlockWhenFull, SpinThenYield<>>> rings;
+  for (int r = 0; r < readers; ++r) {
+    rings.emplace_back(kSlots);
+  }
+  auto start = Clock::now();
+  std::vector<std::thread> threads;
+  for (int r = 0; r < readers; ++r) {
+    threads.emplace_back([&ring = rings[r]] {
+      std::uint64_t sum = 0;
+      for (int n = 0; n < kMessages; ++n) {
+        sum += ring.pop().seq;
+      }
+      sink = sum;
+    });
+  }
+  for (int i = 0; i < kMessages; ++i) {
+    for (auto& ring : rings) {
+      ring.push(Tick{static_cast<std::uint64_t>(i), {}});
+    }
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  return kMessages / std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+}
+
+int main() {
+  // one core for the producer
+  int cores = static_cast<int>(std::thread::hardware_concurrency());
+  int most  = std::clamp(cores - 1, 1, 6);
+  std::printf("%-8s %16s %16s\n", "readers", "broadcast Mt/s", "copies Mt/s");
+  for (int readers = 1; readers <= most; ++readers) {
+    std::printf("%-8d %16.2f %16.2f\n", readers, run_broadcast(readers), run_copies(readers));
+  }
+  return 0;
+}
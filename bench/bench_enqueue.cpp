@@ -0,0 +1,91 @@
+// Cost of MsgQueue::enqueue() for copied and moved payloads.
+//
+// An rvalue travels through the type erasure as an rvalue, so moving a shared_ptr skips
+// the atomic refcount increment/decrement and moving a vector skips the allocation and
+// the deep copy.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include "MsgQueue.hpp"
+#include "backend/RingBuf.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int kMessages = 1000000;
+constexpr int kBatch    = 256;
+
+static std::atomic<long> allocations{0};
+
+void* operator new(size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* p = std::malloc(size)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+struct Result {
+  double ns_per_op;
+  double allocs_per_op;
+};
+
+// enqueues kMessages payloads made by make(i), copied or moved, and drains the queue
+// after every batch on the same thread
+template <typename T, typename Make>
+static Result enqueue(bool move, Make make) {
+  MsgQueue mq(RingBuffer<T, PowerOfTwoCapacity>{kBatch});
+  std::vector<T> payloads;
+  for (int i = 0; i < kBatch; ++i) {
+    payloads.push_back(make(i));
+  }
+  T out;
+  Clock::duration elapsed{};
+  long allocs = 0;
+  for (int i = 0; i < kMessages; i += kBatch) {
+    if (move) {
+      // refill outside of the timed section, a moved-from payload is empty
+      for (int j = 0; j < kBatch; ++j) {
+        payloads[j] = make(j);
+      }
+    }
+    long before = allocations.load(std::memory_order_relaxed);
+    auto start  = Clock::now();
+    for (int j = 0; j < kBatch; ++j) {
+      if (move) {
+        mq.enqueue(std::move(payloads[j]));
+      } else {
+        mq.enqueue(payloads[j]);
+      }
+    }
+    elapsed += Clock::now() - start;
+    allocs += allocations.load(std::memory_order_relaxed) - before;
+    while (mq.dequeue(out)) {
+    }
+  }
+  return {std::chrono::duration<double, std::nano>(elapsed).count() / kMessages,
+          static_cast<double>(allocs) / kMessages};
+}
+
+static void report(const char* name, Result r) {
+  std::printf("%-24s: %8.2f ns/op %6.2f allocs/op\n", name, r.ns_per_op, r.allocs_per_op);
+}
+
+int main() {
+  auto shared = [](int i) { return std::make_shared<int>(i); };
+  auto vector = [](int i) { return std::vector<double>(64, i); };
+  report("shared_ptr, copied", enqueue<std::shared_ptr<int>>(false, shared));
+  report("shared_ptr, moved", enqueue<std::shared_ptr<int>>(true, shared));
+  report("vector<double>, copied", enqueue<std::vector<double>>(false, vector));
+  report("vector<double>, moved", enqueue<std::vector<double>>(true, vector));
+  return 0;
+}
@@ -0,0 +1,66 @@
+// Contention on MpmcRingBuffer: from 2 threads up to every core of the box, half of
+// them producers and half consumers, all hammering one ring.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "backend/MpmcRing.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int kMessages = 2000000;  // in total, split across the producers
+constexpr size_t kSlots = 1024;
+
+// throughput in million messages per second
+static double run(int producers, int consumers) {
+  MpmcRingBuffer<int, PowerOfTwoCapacity, SpinThenYield<>> rb(kSlots);
+  int per_producer = kMessages / producers;
+  std::atomic<int> remaining{per_producer * producers};
+
+  auto start = Clock::now();
+  std::vector<std::thread> threads;
+  for (int p = 0; p < producers; ++p) {
+    threads.emplace_back([&rb, per_producer] {
+      for (int i = 0; i < per_producer; ++i) {
+        rb.push(i);
+      }
+    });
+  }
+  for (int c = 0; c < consumers; ++c) {
+    threads.emplace_back([&rb, &remaining] {
+      int val;
+      while (remaining.load(std::memory_order_relaxed) > 0) {
+        if (rb.try_pop(val)) {
+          remaining.fetch_sub(1, std::memory_order_relaxed);
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  auto elapsed = Clock::now() - start;
+  return per_producer * producers / std::chrono::duration<double, std::micro>(elapsed).count();
+}
+
+int main() {
+  int cores = static_cast<int>(std::max(2u, std::thread::hardware_concurrency()));
+  std::printf("%-8s %-10s %-10s %12s\n", "threads", "producers", "consumers", "Mmsg/s");
+  for (int threads = 2; threads <= cores; threads *= 2) {
+    int producers = threads / 2;
+    std::printf("%-8d %-10d %-10d %12.2f\n", threads, producers, threads - producers,
+                run(producers, threads - producers));
+  }
+  if ((cores & (cores - 1)) != 0) {
+    int producers = cores / 2;
+    std::printf("%-8d %-10d %-10d %12.2f\n", cores, producers, cores - producers,
+                run(producers, cores - producers));
+  }
+  return 0;
+}
@@ -0,0 +1,105 @@
+// Fan-in from N producer threads to one consumer: one MpscRingBuffer shared by all
+// producers against one SPSC RingBuffer per producer that the consumer polls in turn.
+//
+// Every message carries the time it was pushed, the consumer reports the throughput
+// and the mean push-to-pop latency.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "backend/MpscRing.hpp"
+#include "backend/RingBuf.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int kMessages = 400000;  // in total, split across the producers
+constexpr size_t kSlots = 1024;
+
+struct Stamped {
+  Clock::time_point sent;
+};
+
+struct Result {
+  double mmsg_per_s;
+  double latency_ns;
+};
+
+static Result result(Clock::duration elapsed, Clock::duration latency) {
+  return {kMessages / std::chrono::duration<double, std::micro>(elapsed).count(),
+          std::chrono::duration<double, std::nano>(latency).count() / kMessages};
+}
+
+static Result shared_mpsc(int producers) {
+  MpscRingBuffer<Stamped, PowerOfTwoCapacity, SpinThenYield<>> rb(kSlots);
+  auto start = Clock::now();
+  std::vector<std::thread> threads;
+  for (int p = 0; p < producers; ++p) {
+    threads.emplace_back([&rb, producers] {
+      for (int i = 0; i < kMessages / producers; ++i) {
+        rb.push(Stamped{Clock::now()});
+      }
+    });
+  }
+  Clock::duration latency{};
+  for (int n = 0; n < kMessages / producers * producers; ++n) {
+    Stamped m = rb.pop();
+    latency += Clock::now() - m.sent;
+  }
+  auto elapsed = Clock::now() - start;
+  for (auto& t : threads) {
+    t.join();
+  }
+  return result(elapsed, latency);
+}
+
+static Result ring_per_producer(int producers) {
+  using Ring = RingBuffer<Stamped, PowerOfTwoCapacity, BlockWhenFull, SpinThenYield<>>;
+  std::vector<std::unique_ptr<Ring>> rings;
+  for (int p = 0; p < producers; ++p) {
+    rings.push_back(std::make_unique<Ring>(kSlots / producers));
+  }
+  auto start = Clock::now();
+  std::vector<std::thread> threads;
+  for (int p = 0; p < producers; ++p) {
+    threads.emplace_back([ring = rings[p].get(), producers] {
+      for (int i = 0; i < kMessages / producers; ++i) {
+        ring->push(Stamped{Clock::now()});
+      }
+    });
+  }
+  Clock::duration latency{};
+  Stamped m;
+  for (int n = 0; n < kMessages / producers * producers;) {
+    bool idle = true;
+    for (auto& ring : rings) {
+      if (ring->try_pop(m)) {
+        latency += Clock::now() - m.sent;
+        ++n;
+        idle = false;
+      }
+    }
+    if (idle) {
+      std::this_thread::yield();
+    }
+  }
+  auto elapsed = Clock::now() - start;
+  for (auto& t : threads) {
+    t.join();
+  }
+  return result(elapsed, latency);
+}
+
+int main() {
+  std::printf("%-10s %24s %24s\n", "producers", "MpscRingBuffer", "RingBuffer per producer");
+  for (int producers : {2, 4, 8, 16}) {
+    Result mpsc = shared_mpsc(producers);
+    Result spsc = ring_per_producer(producers);
+    std::printf("%-10d %7.2f Mmsg/s %9.0f ns %7.2f Mmsg/s %9.0f ns\n", producers,
+                mpsc.mmsg_per_s, mpsc.latency_ns, spsc.mmsg_per_s, spsc.latency_ns);
+  }
+  return 0;
+}
@@ -0,0 +1,85 @@
+// Cost of RingBuffer::push() with and without a consumer parked in pop().
+//
+// push() only issues a wake-up when the consumer has announced that it is going to
+// sleep, so the first two cases should not pay for a futex syscall at all.
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+#include "backend/RingBuf.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int kMessages = 2000000;
+
+static double ns_per_op(Clock::duration d, int ops) {
+  return std::chrono::duration<double, std::nano>(d).count() / ops;
+}
+
+// nobody ever waits, the same thread drains the ring with try_pop
+static double push_no_waiter() {
+  RingBuffer<int, PowerOfTwoCapacity> rb(1024);
+  int out;
+  Clock::duration pushing{};
+  for (int i = 0; i < kMessages; i += 512) {
+    auto start = Clock::now();
+    for (int j = 0; j < 512; ++j) {
+      rb.push(i + j);
+    }
+    pushing += Clock::now() - start;
+    while (rb.try_pop(out)) {
+    }
+  }
+  return ns_per_op(pushing, kMessages);
+}
+
+// a consumer polls with try_pop on another thread and never parks
+static double push_polling_consumer() {
+  RingBuffer<int, PowerOfTwoCapacity, BlockWhenFull> rb(1024);
+  std::thread consumer([&rb] {
+    int out;
+    for (int n = 0; n < kMessages;) {
+      if (rb.try_pop(out)) {
+        ++n;
+      }
+    }
+  });
+  auto start = Clock::now();
+  for (int i = 0; i < kMessages; ++i) {
+    rb.push(i);
+  }
+  auto elapsed = Clock::now() - start;
+  consumer.join();
+  return ns_per_op(elapsed, kMessages);
+}
+
+// the consumer sleeps in pop() whenever the ring runs dry, so pushes have to wake it
+static double push_sleeping_consumer() {
+  constexpr int messages = kMessages / 20;
+  RingBuffer<int, PowerOfTwoCapacity, BlockWhenFull> rb(1024);
+  std::thread consumer([&rb] {
+    for (int n = 0; n < messages; ++n) {
+      rb.pop();
+    }
+  });
+  Clock::duration pushing{};
+  for (int i = 0; i < messages; ++i) {
+    // give the consumer time to drain the ring and park
+    if (i % 64 == 0) {
+      std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+    auto start = Clock::now();
+    rb.push(i);
+    pushing += Clock::now() - start;
+  }
+  consumer.join();
+  return ns_per_op(pushing, messages);
+}
+
+int main() {
+  std::printf("push, no waiter          : %8.2f ns/op\n", push_no_waiter());
+  std::printf("push, polling consumer   : %8.2f ns/op\n", push_polling_consumer());
+  std::printf("push, sleeping consumer  : %8.2f ns/op\n", push_sleeping_consumer());
+  return 0;
+}
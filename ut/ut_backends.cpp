@@ -0,0 +1,128 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+#include "MsgQueue.hpp"
+#include "backend/BroadcastRing.hpp"
+#include "backend/ConflatingQueue.hpp"
+#include "backend/MpmcRing.hpp"
+#include "backend/MpscRing.hpp"
+#include "backend/RingBuf.hpp"
+#include "backend/TripleBuffer.hpp"
+#include "backend/UnboundedRing.hpp"
+
+#include <chrono>
+#include <functional>
+#include <optional>
+#include <stop_token>
+#include <thread>
+
+// What every backend with a blocking pop does the same way. Each case holds a backend
+// of ints and the side that pops from it.
+
+namespace {
+
+template <typename Backend>
+struct Case {
+  Backend queue;
+  Backend& consumer() { return queue; }
+};
+
+struct RingCase : Case<RingBuffer<int>> {
+  RingCase() : Case{RingBuffer<int>(4)} {}
+};
+
+struct MpscCase : Case<MpscRingBuffer<int>> {
+  MpscCase() : Case{MpscRingBuffer<int>(4)} {}
+};
+
+struct MpmcCase : Case<MpmcRingBuffer<int>> {
+  MpmcCase() : Case{MpmcRingBuffer<int>(4)} {}
+};
+
+struct UnboundedCase : Case<UnboundedRingBuffer<int, 16>> {};
+
+struct TripleCase : Case<TripleBuffer<int>> {};
+
+struct ConflatingCase : Case<ConflatingQueue<int, std::identity>> {
+  ConflatingCase() : Case{ConflatingQueue<int, std::identity>(4)} {}
+};
+
+// not a MsgQueue backend, its readers pop
+struct BroadcastCase {
+  BroadcastRingBuffer<int> queue{4, 1};
+  BroadcastRingBuffer<int>::Reader reader = queue.reader(0);
+  BroadcastRingBuffer<int>::Reader& consumer() { return reader; }
+};
+
+}  // namespace
+
+TEST_CASE_TEMPLATE("timed and cancellable pop", C, RingCase, MpscCase, MpmcCase, UnboundedCase,
+                   TripleCase, ConflatingCase, BroadcastCase) {
+  using namespace std::chrono_literals;
+  C c;
+  auto& consumer = c.consumer();
+
+  auto start = std::chrono::steady_clock::now();
+  CHECK_FALSE(consumer.pop_for(20ms).has_value());
+  CHECK(std::chrono::steady_clock::now() - start >= 20ms);
+  CHECK_FALSE(consumer.pop_until(std::chrono::system_clock::now() + 5ms).has_value());
+
+  c.queue.push(1);
+  std::optional<int> item = consumer.pop_for(1s);
+  REQUIRE(item.has_value());
+  CHECK(*item == 1);
+
+  std::thread producer([&c] {
+    std::this_thread::sleep_for(10ms);
+    c.queue.push(2);
+  });
+  item = consumer.pop_until(std::chrono::steady_clock::now() + 10s);
+  producer.join();
+  REQUIRE(item.has_value());
+  CHECK(*item == 2);
+
+  std::stop_source source;
+  std::thread stopper([&source] {
+    std::this_thread::sleep_for(10ms);
+    source.request_stop();
+  });
+  CHECK_FALSE(consumer.pop(source.get_token()).has_value());
+  stopper.join();
+
+  // pending elements are still handed out after a stop request
+  c.queue.push(3);
+  item = consumer.pop(source.get_token());
+  REQUIRE(item.has_value());
+  CHECK(*item == 3);
+}
+
+TEST_CASE_TEMPLATE("MsgQueue waits through the backend", C, RingCase, MpscCase, MpmcCase,
+                   UnboundedCase, TripleCase, ConflatingCase) {
+  using namespace std::chrono_literals;
+  using Backend = decltype(C::queue);
+  static_assert(TimedBackend<Backend>);
+
+  MsgQueue mq(std::move(C().queue));
+  CHECK(mq.features().timed);
+  CHECK(mq.empty());
+
+  int val = -1;
+  CHECK_FALSE(mq.dequeue_for(val, 5ms));
+  CHECK_FALSE(mq.dequeue_until(val, std::chrono::system_clock::now() + 5ms));
+
+  std::thread producer([&mq] {
+    std::this_thread::sleep_for(10ms);
+    mq.enqueue(1);
+  });
+  CHECK(mq.dequeue_until(val, std::chrono::steady_clock::now() + 10s));
+  producer.join();
+  CHECK(val == 1);
+  CHECK(mq.empty());
+
+  std::stop_source source;
+  std::thread stopper([&source] {
+    std::this_thread::sleep_for(10ms);
+    source.request_stop();
+  });
+  CHECK_FALSE(mq.dequeue_wait(val, source.get_token()));
+  stopper.join();
+}
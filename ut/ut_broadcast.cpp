@@ -0,0 +1,194 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+#include "backend/BroadcastRing.hpp"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+TEST_CASE("BroadcastRingBuffer every reader sees every element") {
+  BroadcastRingBuffer<int> rb(4, 2);
+  auto a = rb.reader(0);
+  auto b = rb.reader(1);
+  CHECK(rb.readers() == 2);
+  CHECK(a.empty());
+
+  for (int i = 0; i < 4; ++i) {
+    CHECK(rb.try_push(i));
+  }
+  // gated by the slowest reader
+  CHECK_FALSE(rb.try_push(4));
+
+  int val = 0;
+  for (int i = 0; i < 4; ++i) {
+    CHECK(a.try_pop(val));
+    CHECK(val == i);
+  }
+  CHECK_FALSE(a.try_pop(val));
+  CHECK_FALSE(rb.try_push(4));
+
+  // in place, up to the end of the buffer
+  auto items = b.peek(8);
+  CHECK(items.size() == 4);
+  CHECK(items[3] == 3);
+  b.release(3);
+  CHECK(rb.try_push(4));
+  CHECK(b.size() == 2);
+  items = b.peek(8);
+  CHECK(items.size() == 1);  // 4 has wrapped to the front
+  b.release(1);
+  CHECK(b.pop() == 4);
+  CHECK(a.pop() == 4);
+  CHECK(a.empty());
+}
+
+TEST_CASE("BroadcastRingBuffer drops for the slowest reader") {
+  BroadcastRingBuffer<int, PowerOfTwoCapacity, DropNewest> rb(2, 1);
+  auto r = rb.reader(0);
+  rb.push(1);
+  rb.push(2);
+  rb.push(3);
+  CHECK(rb.dropped() == 1);
+  CHECK(r.pop() == 1);
+  CHECK(r.pop() == 2);
+  CHECK(r.empty());
+}
+
+TEST_CASE("BroadcastRingBuffer overwrites and readers count the loss") {
+  BroadcastRingBuffer<int, DynamicCapacity, OverwriteOldest> rb(4, 2);
+  auto fast = rb.reader(0);
+  auto slow = rb.reader(1);
+  int val   = 0;
+
+  for (int i = 0; i < 10; ++i) {
+    rb.push(i);
+    CHECK(fast.try_pop(val));
+    CHECK(val == i);
+  }
+  // 0 to 5 have been overwritten, 6 to 9 are still there
+  CHECK(slow.try_pop(val));
+  CHECK(val == 6);
+  CHECK(slow.lost() == 6);
+  CHECK(slow.pop() == 7);
+  CHECK(fast.lost() == 0);
+}
+
+TEST_CASE("BroadcastRingBuffer elements live until their slot is reused") {
+  auto sp = std::make_shared<int>(1);
+  {
+    BroadcastRingBuffer<std::shared_ptr<int>> rb(2, 1);
+    auto r = rb.reader(0);
+    rb.push(sp);
+    rb.push(sp);
+    CHECK(*r.pop() == 1);
+    // read, but still in its slot
+    CHECK(sp.use_count() == 3);
+    rb.push(sp);
+    CHECK(sp.use_count() == 3);
+
+    auto moved = std::move(rb);
+  }
+  CHECK(sp.use_count() == 1);
+}
+
+TEST_CASE("BroadcastRingBuffer fan-out to several threads") {
+  constexpr int readers = 4;
+  constexpr int count   = 100000;
+  BroadcastRingBuffer<int, PowerOfTwoCapacity, BlockWhenFull, SpinThenPark<10>> rb(64, readers);
+
+  std::vector<long> sums(readers, 0);
+  std::vector<int> in_order(readers, 1);
+  std::vector<std::thread> threads;
+  for (int r = 0; r < readers; ++r) {
+    threads.emplace_back([&, r] {
+      auto reader = rb.reader(r);
+      for (int i = 0; i < count;) {
+        if (r % 2 == 0) {
+          int val     = reader.pop();
+          in_order[r] = in_order[r] && val == i;
+          sums[r] += val;
+          ++i;
+        } else {
+          auto items = reader.peek(16);
+          for (int val : items) {
+            in_order[r] = in_order[r] && val == i++;
+            sums[r] += val;
+          }
+          reader.release(items.size());
+        }
+      }
+    });
+  }
+  for (int i = 0; i < count; ++i) {
+    rb.push(i);
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  for (int r = 0; r < readers; ++r) {
+    CHECK(in_order[r]);
+    CHECK(sums[r] == long(count) * (count - 1) / 2);
+  }
+}
+
+TEST_CASE("BroadcastRingBuffer pipeline of dependent readers") {
+  // decode -> (risk, persist) -> publish, all on the same slots
+  struct Order {
+    int raw;
+    int decoded;
+    bool risk_checked;
+    bool persisted;
+  };
+  enum { kDecode, kRisk, kPersist, kPublish };
+  constexpr int count = 50000;
+
+  BroadcastRingBuffer<Order, PowerOfTwoCapacity, BlockWhenFull, SpinThenPark<10>> rb(32, 4);
+  rb.depends_on(kRisk, kDecode);
+  rb.depends_on(kPersist, kDecode);
+  rb.depends_on(kPublish, kRisk);
+  rb.depends_on(kPublish, kPersist);
+
+  // a stage takes its elements in place, changes them and passes them on
+  auto stage = [&rb](int reader, auto&& process) {
+    return std::thread([&rb, reader, process] {
+      auto r = rb.reader(reader);
+      for (int n = 0; n < count;) {
+        auto orders = r.peek_mutable(8);
+        if (orders.empty()) {
+          std::this_thread::yield();
+          continue;
+        }
+        for (Order& order : orders) {
+          process(order);
+        }
+        r.release(orders.size());
+        n += static_cast<int>(orders.size());
+      }
+    });
+  };
+
+  std::vector<std::thread> threads;
+  threads.push_back(stage(kDecode, [](Order& o) { o.decoded = o.raw * 2; }));
+  threads.push_back(stage(kRisk, [](Order& o) { o.risk_checked = o.decoded == o.raw * 2; }));
+  threads.push_back(stage(kPersist, [](Order& o) { o.persisted = o.decoded == o.raw * 2; }));
+
+  threads.emplace_back([&rb] {
+    for (int i = 0; i < count; ++i) {
+      rb.push(Order{i, 0, false, false});
+    }
+  });
+
+  // the last stage only sees orders both of its upstream stages are done with
+  auto publish  = rb.reader(kPublish);
+  bool complete = true;
+  for (int i = 0; i < count; ++i) {
+    Order order = publish.pop();
+    complete    = complete && order.raw == i && order.risk_checked && order.persisted;
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  CHECK(complete);
+  CHECK(publish.empty());
+}
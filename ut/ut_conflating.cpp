@@ -0,0 +1,142 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+#include "MsgQueue.hpp"
+#include "backend/ConflatingQueue.hpp"
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Quote {
+  int symbol;
+  long price;
+};
+
+struct BySymbol {
+  int operator()(const Quote& q) const { return q.symbol; }
+};
+
+}  // namespace
+
+TEST_CASE("ConflatingQueue replaces queued messages in place") {
+  ConflatingQueue<Quote, BySymbol> q(3);
+  CHECK(q.empty());
+  CHECK(q.capacity() == 3);
+
+  q.push(Quote{1, 100});
+  q.push(Quote{2, 200});
+  q.push(Quote{1, 101});  // keeps 1 in front of 2
+  q.push(Quote{3, 300});
+  q.push(Quote{2, 201});
+  CHECK(q.size() == 3);
+  CHECK(q.conflated() == 2);
+
+  // a fourth key does not fit
+  CHECK_FALSE(q.try_push(Quote{4, 400}));
+  CHECK(q.dropped() == 1);
+
+  Quote quote{};
+  CHECK(q.try_pop(quote));
+  CHECK(quote.symbol == 1);
+  CHECK(quote.price == 101);
+
+  // 1 has been popped, so its next update queues behind the others
+  q.push(Quote{1, 102});
+  CHECK(q.pop().price == 201);
+  CHECK(q.pop().price == 300);
+  CHECK(q.pop().price == 102);
+  CHECK_FALSE(q.try_pop(quote));
+  CHECK(q.conflated() == 2);
+}
+
+TEST_CASE("ConflatingQueue with move-only messages and a lambda key") {
+  auto key_of = [](const std::unique_ptr<std::string>& s) { return s->front(); };
+  ConflatingQueue<std::unique_ptr<std::string>, decltype(key_of)> q(4, key_of);
+  q.push(std::make_unique<std::string>("apple"));
+  q.push(std::make_unique<std::string>("banana"));
+  q.push(std::make_unique<std::string>("avocado"));
+
+  auto moved = std::move(q);
+  CHECK(moved.size() == 2);
+  CHECK(*moved.pop() == "avocado");
+  CHECK(*moved.pop() == "banana");
+}
+
+TEST_CASE("ConflatingQueue survives a copy that throws") {
+  // copying a negative price throws, moving never does
+  struct Fragile {
+    int symbol;
+    long price;
+
+    Fragile(int s, long p) : symbol(s), price(p) {}
+    Fragile(const Fragile& other) : symbol(other.symbol), price(other.price) {
+      if (price < 0) {
+        throw std::invalid_argument("negative price");
+      }
+    }
+    Fragile(Fragile&&) noexcept            = default;
+    Fragile& operator=(Fragile&&) noexcept = default;
+  };
+  auto symbol = [](const Fragile& f) { return f.symbol; };
+  ConflatingQueue<Fragile, decltype(symbol)> q(2, symbol);
+
+  q.push(Fragile{1, 100});
+  const Fragile bad{1, -1};
+  CHECK_THROWS_AS(q.push(bad), std::invalid_argument);
+
+  // the queued message is untouched and the slot is not stuck
+  CHECK(q.size() == 1);
+  CHECK(q.pop().price == 100);
+  const Fragile good{1, 101};
+  q.push(good);
+  CHECK(q.pop().price == 101);
+  CHECK(q.empty());
+}
+
+TEST_CASE("ConflatingQueue consumer sees the latest price of every symbol") {
+  constexpr int symbols = 16;
+  constexpr int updates = 100000;
+  ConflatingQueue<Quote, BySymbol, SpinThenPark<10>> q(symbols);
+
+  std::thread producer([&q] {
+    for (int i = 0; i < updates; ++i) {
+      q.push(Quote{i % symbols, i});
+    }
+  });
+
+  // prices only go up per symbol and the last one of each arrives
+  std::vector<long> final_prices;
+  for (int s = 0; s < symbols; ++s) {
+    final_prices.push_back(updates - symbols + s);
+  }
+  std::vector<long> last(symbols, -1);
+  bool rising = true;
+  int popped  = 0;
+  while (last != final_prices) {
+    Quote quote = q.pop();
+    rising      = rising && quote.price > last[quote.symbol];
+    last[quote.symbol] = quote.price;
+    ++popped;
+  }
+  producer.join();
+
+  CHECK(rising);
+  CHECK(q.empty());
+  CHECK(popped + static_cast<int>(q.conflated()) == updates);
+}
+
+TEST_CASE("MsgQueue with ConflatingQueue conflates per key") {
+  MsgQueue mq(ConflatingQueue<Quote, BySymbol>{8});
+  mq.enqueue(Quote{1, 1});
+  mq.enqueue(Quote{1, 2});
+  CHECK(mq.size() == 1);
+
+  Quote quote{};
+  CHECK(mq.dequeue(quote));
+  CHECK(quote.price == 2);
+  CHECK(mq.empty());
+}
@@ -0,0 +1,126 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+#include "MsgQueue.hpp"
+#include "backend/MpmcRing.hpp"
+#include "backend/MpscRing.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+TEST_CASE("MpmcRingBuffer single thread") {
+  MpmcRingBuffer<std::unique_ptr<int>> rb(3);
+  CHECK(rb.empty());
+  CHECK(rb.capacity() == 3);
+
+  rb.push(std::make_unique<int>(1));
+  CHECK(rb.try_push(std::make_unique<int>(2)));
+  rb.emplace(new int(3));
+  CHECK_FALSE(rb.try_push(std::make_unique<int>(4)));
+  CHECK(rb.size() == 3);
+
+  std::unique_ptr<int> out;
+  CHECK(rb.try_pop(out));
+  CHECK(*out == 1);
+  CHECK(rb.try_push(std::make_unique<int>(4)));
+
+  // wraps around
+  for (int expected = 2; expected <= 4; ++expected) {
+    CHECK(*rb.pop() == expected);
+  }
+  CHECK_FALSE(rb.try_pop(out));
+  CHECK(rb.empty());
+}
+
+TEST_CASE("MpmcRingBuffer destroys what is left in it") {
+  auto sp = std::make_shared<int>(1);
+  {
+    MpmcRingBuffer<std::shared_ptr<int>, PowerOfTwoCapacity> rb(3);
+    CHECK(rb.capacity() == 4);
+    rb.push(sp);
+    rb.push(sp);
+    auto moved = std::move(rb);
+    CHECK(moved.size() == 2);
+    CHECK(sp.use_count() == 3);
+  }
+  CHECK(sp.use_count() == 1);
+}
+
+// the constructor throws for negative values, the move never does
+struct Checked {
+  explicit Checked(int v) : value(v) {
+    if (v < 0) {
+      throw std::invalid_argument("negative");
+    }
+  }
+  Checked(Checked&&) noexcept = default;
+  Checked& operator=(Checked&&) noexcept = default;
+
+  int value;
+};
+
+TEST_CASE("MpmcRingBuffer survives a constructor that throws") {
+  MpmcRingBuffer<Checked> rb(4);
+  CHECK_THROWS_AS(rb.emplace(-1), std::invalid_argument);
+  CHECK_THROWS_AS(rb.try_emplace(-2), std::invalid_argument);
+  CHECK(rb.empty());
+
+  // no slot was claimed for them, the ring goes on as before
+  rb.emplace(1);
+  CHECK(rb.try_emplace(2));
+  CHECK(rb.pop().value == 1);
+  CHECK(rb.pop().value == 2);
+  CHECK(rb.empty());
+}
+
+TEST_CASE("MpmcRingBuffer many producers and consumers") {
+  constexpr int producers = 3;
+  constexpr int consumers = 3;
+  constexpr int count     = 20000;
+  MpmcRingBuffer<int, PowerOfTwoCapacity, SpinThenPark<10>> rb(8);
+
+  std::vector<std::thread> threads;
+  for (int p = 0; p < producers; ++p) {
+    threads.emplace_back([&rb] {
+      for (int i = 1; i <= count; ++i) {
+        rb.push(i);
+      }
+    });
+  }
+  std::atomic<long> sum{0};
+  std::atomic<int> popped{0};
+  for (int c = 0; c < consumers; ++c) {
+    threads.emplace_back([&] {
+      int val;
+      while (popped.load() < producers * count) {
+        if (rb.try_pop(val)) {
+          sum += val;
+          ++popped;
+        } else if (auto item = rb.pop_for(std::chrono::milliseconds(1))) {
+          sum += *item;
+          ++popped;
+        }
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  CHECK(popped == producers * count);
+  CHECK(sum == static_cast<long>(producers) * count * (count + 1) / 2);
+  CHECK(rb.empty());
+}
+
+TEST_CASE("MsgQueue with MpmcRingBuffer reports many consumers") {
+  static_assert(MultiProducerBackend<MpmcRingBuffer<int>>);
+  static_assert(MultiConsumerBackend<MpmcRingBuffer<int>>);
+  static_assert(!MultiConsumerBackend<MpscRingBuffer<int>>);
+
+  MsgQueue mq(MpmcRingBuffer<int>{16});
+  CHECK(mq.features().multi_producer);
+  CHECK(mq.features().multi_consumer);
+}
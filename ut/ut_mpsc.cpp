@@ -0,0 +1,168 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+#include "MsgQueue.hpp"
+#include "backend/MpscRing.hpp"
+
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+TEST_CASE("MpscRingBuffer single thread") {
+  MpscRingBuffer<int> rb(3);
+  CHECK(rb.empty());
+  CHECK(rb.capacity() == 3);
+
+  rb.push(1);
+  CHECK(rb.try_push(2));
+  rb.emplace(3);
+  CHECK_FALSE(rb.try_push(4));
+  CHECK(rb.size() == 3);
+
+  int val = 0;
+  CHECK(rb.try_pop(val));
+  CHECK(val == 1);
+  CHECK(rb.try_push(4));
+
+  // wraps around
+  std::vector<int> drained;
+  CHECK(rb.drain([&](int& m) { drained.push_back(m); }) == 3);
+  CHECK(drained == std::vector<int>{2, 3, 4});
+  CHECK_FALSE(rb.try_pop(val));
+  CHECK(rb.empty());
+}
+
+TEST_CASE("MpscRingBuffer with move-only elements") {
+  auto sp = std::make_shared<int>(1);
+  {
+    MpscRingBuffer<std::unique_ptr<std::shared_ptr<int>>, PowerOfTwoCapacity> rb(3);
+    CHECK(rb.capacity() == 4);
+    rb.push(std::make_unique<std::shared_ptr<int>>(sp));
+    rb.push(std::make_unique<std::shared_ptr<int>>(sp));
+    CHECK(sp.use_count() == 3);
+    CHECK(*rb.pop() == sp);
+    CHECK(sp.use_count() == 2);
+
+    auto moved = std::move(rb);
+    CHECK(moved.size() == 1);
+  }
+  // the ring destroys what is left in it
+  CHECK(sp.use_count() == 1);
+}
+
+TEST_CASE("MpscRingBuffer drain consumes the elements before a throw") {
+  MpscRingBuffer<int> rb(4);
+  for (int i = 0; i < 4; ++i) {
+    rb.push(i);
+  }
+  int calls = 0;
+  CHECK_THROWS_AS(rb.drain([&](int& m) {
+    ++calls;
+    if (m == 2) {
+      throw std::runtime_error("handler failed");
+    }
+  }),
+                  std::runtime_error);
+  CHECK(calls == 3);
+  CHECK(rb.size() == 2);
+
+  // the freed slots take new elements and the rest is still read in order
+  CHECK(rb.try_push(4));
+  CHECK(rb.try_push(5));
+  CHECK_FALSE(rb.try_push(6));
+  std::vector<int> drained;
+  CHECK(rb.drain([&](int& m) { drained.push_back(m); }) == 4);
+  CHECK(drained == std::vector<int>{2, 3, 4, 5});
+}
+
+// the constructor throws for negative values, the move never does
+struct Checked {
+  explicit Checked(int v) : value(v) {
+    if (v < 0) {
+      throw std::invalid_argument("negative");
+    }
+  }
+  Checked(Checked&&) noexcept = default;
+  Checked& operator=(Checked&&) noexcept = default;
+
+  int value;
+};
+
+TEST_CASE("MpscRingBuffer survives a constructor that throws") {
+  MpscRingBuffer<Checked> rb(4);
+  CHECK_THROWS_AS(rb.emplace(-1), std::invalid_argument);
+  CHECK_THROWS_AS(rb.try_emplace(-2), std::invalid_argument);
+  CHECK(rb.empty());
+
+  // no slot was claimed for them, the ring goes on as before
+  rb.emplace(1);
+  CHECK(rb.try_emplace(2));
+  CHECK(rb.pop().value == 1);
+  CHECK(rb.pop().value == 2);
+  CHECK(rb.empty());
+}
+
+TEST_CASE("MpscRingBuffer many producers") {
+  constexpr int producers = 4;
+  constexpr int count     = 20000;
+  MpscRingBuffer<std::pair<int, int>, DynamicCapacity, SpinThenPark<10>> rb(16);
+
+  std::vector<std::thread> threads;
+  for (int p = 0; p < producers; ++p) {
+    threads.emplace_back([&rb, p] {
+      for (int i = 0; i < count; ++i) {
+        if (i % 2 == 0) {
+          rb.push(std::pair(p, i));
+        } else {
+          while (!rb.try_push(std::pair(p, i))) {
+            std::this_thread::yield();
+          }
+        }
+      }
+    });
+  }
+
+  // every producer's messages arrive in the order it pushed them
+  std::vector<int> next(producers, 0);
+  bool in_order = true;
+  for (int n = 0; n < producers * count; ++n) {
+    auto [p, i] = rb.pop();
+    in_order    = in_order && next[p] == i;
+    next[p]     = i + 1;
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  CHECK(in_order);
+  CHECK(next == std::vector<int>(producers, count));
+  CHECK(rb.empty());
+}
+
+TEST_CASE("MsgQueue with MpscRingBuffer from many producers") {
+  static_assert(MultiProducerBackend<MpscRingBuffer<int>> && BoundedBackend<MpscRingBuffer<int>>);
+
+  MsgQueue mq(MpscRingBuffer<int>{64});
+  CHECK(mq.features().multi_producer);
+
+  std::vector<std::thread> threads;
+  for (int p = 0; p < 3; ++p) {
+    threads.emplace_back([&mq] {
+      for (int i = 1; i <= 100; ++i) {
+        mq.enqueue(i);
+      }
+    });
+  }
+
+  long sum = 0;
+  for (int n = 0; n < 300; ++n) {
+    int val = 0;
+    mq.dequeue_wait(val);
+    sum += val;
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  CHECK(sum == 3 * 5050);
+  CHECK(mq.empty());
+}
@@ -3,6 +3,17 @@
 #include "MsgQueue.hpp"
 #include "backend/RingBuf.hpp"
 
+#include <array>
+#include <deque>
+#include <limits>
+#include <optional>
+#include <span>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
 TEST_CASE("message queue") {
   MsgQueue mq(RingBuffer<int>{10});
 
@@ -35,6 +46,423 @@ TEST_CASE("message queue multiple enqueue and dequeue") {
   CHECK(!success);
 }
 
+TEST_CASE("message queue with StaticRingBuffer") {
+  MsgQueue mq(StaticRingBuffer<int, 8>{});
+
+  for (int i = 0; i < 5; ++i) {
+    mq.enqueue(i);
+  }
+  CHECK(mq.size() == 5);
+
+  for (int i = 0; i < 5; ++i) {
+    int val = -1;
+    CHECK(mq.dequeue(val));
+    CHECK(val == i);
+  }
+  CHECK(mq.empty());
+}
+
+TEST_CASE("message queue blocking dequeue") {
+  MsgQueue mq(RingBuffer<int, DynamicCapacity, BlockWhenFull, SpinThenPark<50>>{4});
+
+  std::thread producer([&mq] {
+    for (int i = 0; i < 1000; ++i) {
+      mq.enqueue(i);
+    }
+  });
+
+  bool in_order = true;
+  for (int i = 0; i < 1000; ++i) {
+    int val = -1;
+    mq.dequeue_wait(val);
+    in_order = in_order && val == i;
+  }
+  producer.join();
+
+  CHECK(in_order);
+  CHECK(mq.empty());
+}
+
+TEST_CASE("message queue timed and cancellable dequeue") {
+  using namespace std::chrono_literals;
+  MsgQueue mq(RingBuffer<int>{4});
+
+  int val = -1;
+  CHECK_FALSE(mq.dequeue_for(val, 5ms));
+  CHECK_FALSE(mq.dequeue_until(val, std::chrono::system_clock::now() + 5ms));
+
+  mq.enqueue(3);
+  CHECK(mq.dequeue_until(val, std::chrono::steady_clock::now() + 1s));
+  CHECK(val == 3);
+
+  std::stop_source source;
+  std::thread stopper([&source] {
+    std::this_thread::sleep_for(10ms);
+    source.request_stop();
+  });
+  CHECK_FALSE(mq.dequeue_wait(val, source.get_token()));
+  stopper.join();
+
+  // pending messages are still handed out after a stop request
+  mq.enqueue(4);
+  CHECK(mq.dequeue_wait(val, source.get_token()));
+  CHECK(val == 4);
+}
+
+TEST_CASE("message queue emplace") {
+  MsgQueue mq(RingBuffer<std::pair<std::string, int>>{4});
+
+  std::string name = "bid";
+  mq.emplace<std::pair<std::string, int>>(name, 1);
+  mq.emplace<std::pair<std::string, int>>(std::move(name), 2);
+  CHECK(mq.size() == 2);
+
+  std::pair<std::string, int> out;
+  CHECK(mq.dequeue(out));
+  CHECK(out == std::pair<std::string, int>("bid", 1));
+  CHECK(mq.dequeue(out));
+  CHECK(out == std::pair<std::string, int>("bid", 2));
+  CHECK(name.empty());
+}
+
+TEST_CASE("message queue moves rvalues and copies lvalues") {
+  MsgQueue mq(RingBuffer<std::shared_ptr<int>>{4});
+
+  auto sp = std::make_shared<int>(1);
+  mq.enqueue(sp);
+  CHECK(sp.use_count() == 2);
+
+  const auto csp = sp;
+  mq.enqueue(csp);
+  CHECK(sp.use_count() == 4);
+
+  mq.enqueue(std::move(sp));
+  CHECK(sp == nullptr);
+  CHECK(csp.use_count() == 4);
+
+  std::shared_ptr<int> out;
+  while (mq.dequeue(out)) {
+  }
+  CHECK(csp.use_count() == 2);
+
+  MsgQueue unique(RingBuffer<std::unique_ptr<int>>{4});
+  unique.enqueue(std::make_unique<int>(2));
+  std::unique_ptr<int> owned;
+  CHECK(unique.dequeue(owned));
+  CHECK(*owned == 2);
+}
+
+// the bare minimum a backend has to provide, no blocking pops and no emplace
+struct MinimalBackend {
+  using BufferElement = int;
+
+  void push(int m) { ring.push(m); }
+  bool try_pop(int& m) { return ring.try_pop(m); }
+  bool empty() const { return ring.empty(); }
+  size_t size() const { return ring.size(); }
+
+  RingBuffer<int> ring{8};
+};
+
+// blocks in pop() but cannot time out
+struct BlockingOnlyBackend : MinimalBackend {
+  int pop() { return ring.pop(); }
+};
+
+static_assert(TimedBackend<RingBuffer<int>>);
+static_assert(BlockingBackend<BlockingOnlyBackend> && !TimedBackend<BlockingOnlyBackend>);
+static_assert(!BlockingBackend<MinimalBackend>);
+
+TEST_CASE("message queue blocks through a backend without timeouts") {
+  using namespace std::chrono_literals;
+  MsgQueue mq(BlockingOnlyBackend{});
+
+  std::thread producer([&mq] {
+    std::this_thread::sleep_for(10ms);
+    mq.enqueue(1);
+  });
+  int val = 0;
+  mq.dequeue_wait(val);
+  producer.join();
+  CHECK(val == 1);
+
+  // timed dequeue falls back to polling
+  CHECK_FALSE(mq.dequeue_for(val, 5ms));
+  mq.enqueue(2);
+  CHECK(mq.dequeue_for(val, 1s));
+  CHECK(val == 2);
+}
+
+TEST_CASE("statically typed BasicMsgQueue") {
+  using namespace std::chrono_literals;
+  BasicMsgQueue mq(RingBuffer<std::pair<std::string, int>>{4});
+
+  std::pair<std::string, int> m{"bid", 1};
+  mq.enqueue(m);
+  mq.enqueue(std::move(m));
+  mq.emplace("ask", 2);
+  CHECK(mq.size() == 3);
+
+  std::pair<std::string, int> out;
+  CHECK(mq.dequeue(out));
+  CHECK(out.first == "bid");
+  mq.dequeue_wait(out);
+  CHECK(out.first == "bid");
+  CHECK(mq.dequeue_for(out, 1s));
+  CHECK(out == std::pair<std::string, int>("ask", 2));
+  CHECK_FALSE(mq.dequeue_until(out, std::chrono::system_clock::now() + 5ms));
+  CHECK(mq.empty());
+
+  BasicMsgQueue minimal(MinimalBackend{});
+  minimal.emplace(7);
+  int val = 0;
+  minimal.dequeue_wait(val);
+  CHECK(val == 7);
+  CHECK_FALSE(minimal.dequeue_for(val, 5ms));
+  std::stop_source source;
+  source.request_stop();
+  CHECK_FALSE(minimal.dequeue_wait(val, source.get_token()));
+
+  // the type erased queue behaves the same on top of it
+  MsgQueue erased(MinimalBackend{});
+  erased.emplace<int>(8);
+  CHECK(erased.dequeue_for(val, 1s));
+  CHECK(val == 8);
+}
+
+TEST_CASE("message queue keeps small backends inline") {
+  static_assert(sizeof(MsgQueue) <= kMsgQueueInlineSize + kCacheLineSize);
+
+  // a RingBuffer fits inline, a StaticRingBuffer with 64 slots goes to the heap
+  std::vector<MsgQueue> queues;
+  queues.emplace_back(RingBuffer<std::shared_ptr<int>>{4});
+  queues.emplace_back(StaticRingBuffer<std::shared_ptr<int>, 64>{});
+
+  auto sp = std::make_shared<int>(1);
+  for (auto& mq : queues) {
+    mq.enqueue(sp);
+  }
+  CHECK(sp.use_count() == 3);
+
+  // moving a queue moves an inline backend along and hands a heap one over
+  for (int i = 0; i < 16; ++i) {
+    queues.emplace_back(RingBuffer<std::shared_ptr<int>>{4});
+  }
+  MsgQueue moved(std::move(queues[0]));
+  moved = std::move(queues[1]);
+  CHECK(sp.use_count() == 2);
+  CHECK(moved.size() == 1);
+
+  std::shared_ptr<int> out;
+  CHECK(moved.dequeue(out));
+  CHECK(out == sp);
+  CHECK(queues[2].empty());
+
+  queues.clear();
+  out.reset();
+  CHECK(sp.use_count() == 1);
+
+  SizedMsgQueue<kCacheLineSize> heap_only(RingBuffer<int>{4});
+  heap_only.enqueue(5);
+  int val = 0;
+  CHECK(heap_only.dequeue(val));
+  CHECK(val == 5);
+}
+
+// small enough to be inlined, but its move is not noexcept
+struct ThrowingMoveBackend {
+  using BufferElement = int;
+
+  explicit ThrowingMoveBackend(int* moves) : moves(moves) {}
+  ThrowingMoveBackend(ThrowingMoveBackend&& other) noexcept(false)
+      : items(std::move(other.items)), moves(other.moves) {
+    ++*moves;
+  }
+
+  void push(int m) { items.push_back(m); }
+  bool try_pop(int& m) {
+    if (items.empty()) {
+      return false;
+    }
+    m = items.front();
+    items.pop_front();
+    return true;
+  }
+  bool empty() const { return items.empty(); }
+  size_t size() const { return items.size(); }
+
+  std::deque<int> items;
+  int* moves;
+};
+
+TEST_CASE("message queue keeps backends that may throw on move on the heap") {
+  int moves = 0;
+  MsgQueue mq(ThrowingMoveBackend{&moves});
+  mq.enqueue(1);
+  int constructed = moves;
+
+  // a heap backend is handed over by pointer, never moved
+  MsgQueue moved(std::move(mq));
+  moved = MsgQueue(std::move(moved));
+  CHECK(moves == constructed);
+
+  int val = 0;
+  CHECK(moved.dequeue(val));
+  CHECK(val == 1);
+}
+
+template <typename Backend>
+void check_batches(Backend backend) {
+  MsgQueue mq(std::move(backend));
+
+  std::vector<int> burst = {1, 2, 3, 4, 5, 6};
+  CHECK(mq.enqueue_n(std::span<const int>(burst)) == 6);
+  CHECK(mq.size() == 6);
+
+  std::array<int, 4> out{};
+  CHECK(mq.dequeue_n(std::span<int>(out)) == 4);
+  CHECK(out == std::array<int, 4>{1, 2, 3, 4});
+
+  CHECK(mq.enqueue_n(std::span<int>(burst)) == 6);
+  std::vector<int> drained;
+  auto collect = [&drained](int& m) { drained.push_back(m); };
+  CHECK(mq.drain<int>(collect, 3) == 3);
+  CHECK(mq.drain<int>(collect) == 5);
+  CHECK(drained == std::vector<int>{5, 6, 1, 2, 3, 4, 5, 6});
+  CHECK(mq.empty());
+}
+
+TEST_CASE("message queue batches") {
+  check_batches(RingBuffer<int>{16});
+  check_batches(MinimalBackend{});
+
+  // enqueue_n never overwrites
+  MsgQueue mq(RingBuffer<std::unique_ptr<int>>{2});
+  std::vector<std::unique_ptr<int>> owned;
+  for (int i = 0; i < 3; ++i) {
+    owned.push_back(std::make_unique<int>(i));
+  }
+  CHECK(mq.enqueue_n(std::span(owned)) == 2);
+  CHECK(owned[0] == nullptr);
+  CHECK(*owned[2] == 2);
+  std::vector<std::unique_ptr<int>> out(3);
+  CHECK(mq.dequeue_n(std::span(out)) == 2);
+  CHECK(*out[1] == 1);
+}
+
+// a message without a default constructor
+struct NoDefault {
+  explicit NoDefault(int v) : value(v) {}
+  int value;
+};
+
+// neither drains natively nor can pop without a message to pop into
+struct NoDefaultBackend {
+  using BufferElement = NoDefault;
+
+  void push(NoDefault m) { ring.push(m); }
+  bool try_pop(NoDefault& m) { return ring.try_pop(m); }
+  bool empty() const { return ring.empty(); }
+  size_t size() const { return ring.size(); }
+
+  RingBuffer<NoDefault> ring{8};
+};
+
+// no native drain either, but it can pop into an optional
+struct NoDefaultTimedBackend : NoDefaultBackend {
+  NoDefault pop() { return ring.pop(); }
+  std::optional<NoDefault> pop_until(std::chrono::steady_clock::time_point deadline) {
+    return ring.pop_until(deadline);
+  }
+  std::optional<NoDefault> pop(std::stop_token stop) { return ring.pop(stop); }
+};
+
+static_assert(TimedBackend<NoDefaultTimedBackend>);
+
+// MsgQueue::drain() terminates instead
+template <typename Backend>
+concept Drainable = requires(BasicMsgQueue<Backend> q, void (&f)(NoDefault&)) { q.drain(f); };
+static_assert(!Drainable<NoDefaultBackend> && Drainable<NoDefaultTimedBackend>);
+
+TEST_CASE("message queue with messages that are not default constructible") {
+  MsgQueue plain(NoDefaultBackend{});
+  plain.enqueue(NoDefault(1));
+  NoDefault m(0);
+  CHECK(plain.dequeue(m));
+  CHECK(m.value == 1);
+
+  MsgQueue timed(NoDefaultTimedBackend{});
+  for (int i = 0; i < 3; ++i) {
+    timed.enqueue(NoDefault(i));
+  }
+  std::vector<int> drained;
+  CHECK(timed.drain<NoDefault>([&](NoDefault& n) { drained.push_back(n.value); }) == 3);
+  CHECK(drained == std::vector<int>{0, 1, 2});
+  CHECK(timed.empty());
+
+  BasicMsgQueue typed(NoDefaultTimedBackend{});
+  typed.enqueue(NoDefault(4));
+  CHECK(typed.drain([&](NoDefault& n) { drained.push_back(n.value); }, 1) == 1);
+  CHECK(drained.back() == 4);
+}
+
+static_assert(BulkBackend<RingBuffer<int>> && ZeroCopyBackend<RingBuffer<int>>);
+static_assert(BoundedBackend<RingBuffer<int>> && !MultiProducerBackend<RingBuffer<int>>);
+static_assert(!ZeroCopyBackend<MinimalBackend> && !BoundedBackend<MinimalBackend>);
+
+TEST_CASE("message queue capabilities") {
+  MsgQueue mq(RingBuffer<int, PowerOfTwoCapacity>{6});
+  BackendFeatures features = mq.features();
+  CHECK(features.bulk);
+  CHECK(features.timed);
+  CHECK(features.zero_copy);
+  CHECK_FALSE(features.multi_producer);
+  CHECK(mq.capacity() == 8);
+
+  std::span<int> slots = mq.reserve<int>(3);
+  REQUIRE(slots.size() == 3);
+  slots[0] = 1;
+  slots[1] = 2;
+  mq.commit(2);
+  CHECK(mq.size() == 2);
+
+  std::span<const int> items = mq.peek<int>(4);
+  REQUIRE(items.size() == 2);
+  CHECK(items[1] == 2);
+  mq.release(2);
+  CHECK(mq.empty());
+
+  // generic fallbacks for a backend without the capabilities
+  MsgQueue minimal(MinimalBackend{});
+  CHECK_FALSE(minimal.features().zero_copy);
+  CHECK_FALSE(minimal.features().bounded);
+  CHECK(minimal.capacity() == std::numeric_limits<size_t>::max());
+  CHECK(minimal.reserve<int>(1).empty());
+  CHECK(minimal.peek<int>(1).empty());
+
+  BasicMsgQueue typed(RingBuffer<int>{4});
+  static_assert(BasicMsgQueue<RingBuffer<int>>::features().zero_copy);
+  typed.reserve(1)[0] = 5;
+  typed.commit(1);
+  CHECK(typed.peek(1)[0] == 5);
+  typed.release(1);
+  CHECK(typed.capacity() == 4);
+
+  // the same calls compile against the typed and the type-erased queue
+  auto round_trip = [](auto& q) {
+    q.template reserve<int>(1)[0] = 6;
+    q.commit(1);
+    CHECK(q.template peek<int>(1)[0] == 6);
+    q.release(1);
+    q.enqueue(7);
+    int sum = 0;
+    CHECK(q.template drain<int>([&sum](int& m) { sum += m; }) == 1);
+    CHECK(sum == 7);
+  };
+  round_trip(typed);
+  round_trip(mq);
+}
+
 bool float_equal(double a, double b, double epsilon = 1e-5) { return std::abs(a - b) <= epsilon; }
 
 TEST_CASE("MsgQueue with shared_ptr<double>, no Approx") {
@@ -70,7 +498,7 @@ TEST_CASE("MsgQueue with shared_ptr<double>, no Approx") {
 
 TEST_CASE("RingBuffer overwrite old data when full (shared_ptr<double>)") {
   constexpr int capacity = 3;
-  RingBuffer<std::shared_ptr<double>> rb(capacity);
+  RingBuffer<std::shared_ptr<double>, DynamicCapacity, OverwriteOldest> rb(capacity);
   MsgQueue mq(std::move(rb));
 
   for (int i = 0; i < capacity; ++i) {
@@ -2,6 +2,14 @@
 #include "doctest.h"
 #include "backend/RingBuf.hpp"
 
+#include <array>
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
 TEST_CASE("RingBuffer move constructor") {
   RingBuffer<int> rb1(5);
   rb1.push(1);
@@ -50,7 +58,7 @@ TEST_CASE("RingBuffer<std::shared_ptr<int>> push/pop and refcount") {
 }
 
 TEST_CASE("RingBuffer<std::shared_ptr<int>> overwrite oldest element") {
-  RingBuffer<std::shared_ptr<int>> rb(2);
+  RingBuffer<std::shared_ptr<int>, DynamicCapacity, OverwriteOldest> rb(2);
 
   auto sp1 = std::make_shared<int>(1);
   auto sp2 = std::make_shared<int>(2);
@@ -73,10 +81,22 @@ TEST_CASE("RingBuffer<std::shared_ptr<int>> overwrite oldest element") {
   CHECK(*out_sp == 3);
 
   CHECK(rb.empty());
+
+  // peek() claims what it shows, which still counts until it is released
+  rb.push(sp1);
+  rb.push(sp2);
+  CHECK(rb.peek().size() == 1);
+  CHECK(rb.size() == 2);
+  rb.release();
+  CHECK(rb.peek().size() == 1);
+  CHECK(rb.size() == 1);
+  CHECK_FALSE(rb.empty());
+  rb.release();
+  CHECK(rb.empty());
 }
 
 TEST_CASE("Iterator") {
-  RingBuffer<int> rb1(5);
+  RingBuffer<int, DynamicCapacity, OverwriteOldest> rb1(5);
   size_t cnt = 1;
   rb1.push(1);
   rb1.push(2);
@@ -105,7 +125,7 @@ TEST_CASE("Iterator") {
     CHECK(x == cnt++);
   }
 
-  RingBuffer<int> rb2(5);
+  RingBuffer<int, DynamicCapacity, OverwriteOldest> rb2(5);
   cnt = 3;
   rb2.push(7);
   rb2.push(6);
@@ -144,4 +164,481 @@ TEST_CASE("Iterator") {
   for (auto it = rb3.cbegin(); it != rb3.cend(); ++it) {
     CHECK(*it == cnt++);
   }
-}
\ No newline at end of file
+}
+
+TEST_CASE("RingBuffer producer and consumer on different threads") {
+  constexpr int count = 100000;
+  RingBuffer<int> rb(64);
+
+  std::thread producer([&rb] {
+    for (int i = 0; i < count;) {
+      if (rb.size() < 32) {
+        rb.push(i++);
+      } else {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  bool in_order = true;
+  for (int expected = 0; expected < count; ++expected) {
+    in_order = in_order && (rb.pop() == expected);
+  }
+  producer.join();
+
+  CHECK(in_order);
+  CHECK(rb.empty());
+}
+
+TEST_CASE("RingBuffer power-of-two capacity") {
+  RingBuffer<int, PowerOfTwoCapacity, OverwriteOldest> rb(5);
+  CHECK(rb.capacity() == 8);
+
+  for (int i = 0; i < 8; ++i) {
+    rb.push(i);
+  }
+  CHECK(rb.size() == 8);
+
+  // the ring is full, the oldest element is dropped
+  rb.push(8);
+  CHECK(rb.size() == 8);
+
+  int cnt = 1;
+  for (auto& x : rb) {
+    CHECK(x == cnt++);
+  }
+  cnt = 8;
+  for (auto it = rb.rbegin(); it != rb.rend(); ++it) {
+    CHECK(*it == cnt--);
+  }
+
+  int val;
+  for (int i = 1; i <= 8; ++i) {
+    CHECK(rb.try_pop(val));
+    CHECK(val == i);
+  }
+  CHECK_FALSE(rb.try_pop(val));
+  CHECK(rb.empty());
+}
+
+TEST_CASE("RingBuffer uses every slot") {
+  RingBuffer<int> rb(3);
+  CHECK(rb.capacity() == 3);
+
+  for (int round = 0; round < 10; ++round) {
+    rb.push(round);
+    rb.push(round + 1);
+    rb.push(round + 2);
+    CHECK(rb.size() == 3);
+    CHECK(rb.pop() == round);
+    CHECK(rb.pop() == round + 1);
+    CHECK(rb.pop() == round + 2);
+    CHECK(rb.empty());
+  }
+}
+
+constinit RingBuffer<int, FixedCapacity<16>, OverwriteOldest> static_rb;
+
+TEST_CASE("StaticRingBuffer") {
+  static_assert(sizeof(StaticRingBuffer<int, 16>) >= 16 * sizeof(int));
+  CHECK(static_rb.capacity() == 16);
+  CHECK(static_rb.empty());
+
+  for (int i = 0; i < 20; ++i) {
+    static_rb.push(i);
+  }
+  CHECK(static_rb.size() == 16);
+
+  int cnt = 4;
+  for (auto& x : static_rb) {
+    CHECK(x == cnt++);
+  }
+
+  RingBuffer<int, FixedCapacity<16>, OverwriteOldest> moved(std::move(static_rb));
+  int val;
+  for (int i = 4; i < 20; ++i) {
+    CHECK(moved.try_pop(val));
+    CHECK(val == i);
+  }
+  CHECK(moved.empty());
+}
+
+TEST_CASE("StaticRingBuffer moved-from while full takes new elements") {
+  using Ring = RingBuffer<int, FixedCapacity<4>, OverwriteOldest>;
+  Ring full;
+  for (int i = 0; i < 4; ++i) {
+    full.push(i);
+  }
+  Ring moved(std::move(full));
+  CHECK(moved.size() == 4);
+  CHECK(full.empty());
+
+  // the moved-from ring is empty, pushing must neither wait nor overwrite
+  for (int i = 10; i < 14; ++i) {
+    full.push(i);
+  }
+  CHECK(full.dropped() == 0);
+  full.push(14);
+  CHECK(full.dropped() == 1);
+
+  int val = 0;
+  for (int i = 11; i < 15; ++i) {
+    CHECK(full.try_pop(val));
+    CHECK(val == i);
+  }
+  CHECK(full.empty());
+}
+
+TEST_CASE("RingBuffer bulk push_n and try_pop_n") {
+  RingBuffer<int> rb(8);
+  std::vector<int> in{0, 1, 2, 3, 4, 5};
+  std::vector<int> out(6, -1);
+
+  CHECK(rb.push_n(std::span<const int>(in)) == 6);
+  CHECK(rb.try_pop_n(std::span(out).first(4)) == 4);
+  CHECK(out[3] == 3);
+
+  // wraps around the end of the storage, only 6 of the 10 elements fit
+  std::vector<int> more{6, 7, 8, 9, 10, 11, 12, 13, 14, 15};
+  CHECK(rb.push_n(std::span(more)) == 6);
+  CHECK(rb.size() == 8);
+  CHECK(rb.push_n(std::span(more)) == 0);
+
+  std::vector<int> all(10, -1);
+  CHECK(rb.try_pop_n(std::span(all)) == 8);
+  for (int i = 0; i < 8; ++i) {
+    CHECK(all[i] == i + 4);
+  }
+  CHECK(rb.try_pop_n(std::span(all)) == 0);
+  CHECK(rb.empty());
+}
+
+TEST_CASE("RingBuffer bulk operations move non-trivial elements") {
+  RingBuffer<std::shared_ptr<int>> rb(4);
+  std::vector<std::shared_ptr<int>> in{std::make_shared<int>(1), std::make_shared<int>(2)};
+  auto keep = in[0];
+
+  CHECK(rb.push_n(std::span(in)) == 2);
+  CHECK(in[0] == nullptr);
+  CHECK(keep.use_count() == 2);
+
+  std::vector<std::shared_ptr<int>> out(2);
+  CHECK(rb.try_pop_n(std::span(out)) == 2);
+  CHECK(*out[0] == 1);
+  CHECK(*out[1] == 2);
+  CHECK(keep.use_count() == 2);
+}
+
+TEST_CASE("RingBuffer reserve/commit and peek/release") {
+  RingBuffer<std::array<int, 4>> rb(4);
+
+  CHECK(rb.peek().empty());
+
+  auto slots = rb.reserve();
+  REQUIRE(slots.size() == 1);
+  slots[0] = {1, 2, 3, 4};
+  CHECK(rb.empty());
+  rb.commit();
+  CHECK(rb.size() == 1);
+
+  auto view = rb.peek();
+  REQUIRE(view.size() == 1);
+  CHECK(view[0][3] == 4);
+  rb.release();
+  CHECK(rb.empty());
+
+  // three slots left before the end of the storage, the span stops there
+  slots = rb.reserve(4);
+  CHECK(slots.size() == 3);
+  rb.commit(3);
+  CHECK(rb.reserve(4).size() == 1);
+  CHECK(rb.peek(8).size() == 3);
+  rb.release(3);
+  CHECK(rb.peek(8).empty());
+}
+
+TEST_CASE("RingBuffer release drops shared_ptr references") {
+  RingBuffer<std::shared_ptr<int>> rb(2);
+  auto sp = std::make_shared<int>(7);
+
+  rb.reserve()[0] = sp;
+  rb.commit();
+  CHECK(sp.use_count() == 2);
+  CHECK(*rb.peek()[0] == 7);
+  rb.release();
+  CHECK(sp.use_count() == 1);
+}
+
+TEST_CASE("RingBuffer try_push rejects when full") {
+  RingBuffer<int> rb(2);
+  CHECK(rb.try_push(1));
+  CHECK(rb.try_push(2));
+  CHECK_FALSE(rb.try_push(3));
+  CHECK(rb.size() == 2);
+  CHECK(rb.dropped() == 0);
+
+  CHECK(rb.pop() == 1);
+  CHECK(rb.try_push(3));
+  CHECK(rb.pop() == 2);
+  CHECK(rb.pop() == 3);
+}
+
+TEST_CASE("RingBuffer DropNewest counts dropped elements") {
+  RingBuffer<int, DynamicCapacity, DropNewest> rb(3);
+  for (int i = 0; i < 5; ++i) {
+    rb.push(i);
+  }
+  CHECK(rb.size() == 3);
+  CHECK(rb.dropped() == 2);
+
+  CHECK(rb.pop() == 0);
+  CHECK(rb.pop() == 1);
+  CHECK(rb.pop() == 2);
+  CHECK(rb.empty());
+}
+
+TEST_CASE("RingBuffer BlockWhenFull applies backpressure") {
+  constexpr int count = 20000;
+  RingBuffer<int, DynamicCapacity, BlockWhenFull> rb(4);
+
+  std::thread producer([&rb] {
+    for (int i = 0; i < count; ++i) {
+      rb.push(i);
+    }
+  });
+
+  bool in_order = true;
+  for (int expected = 0; expected < count; ++expected) {
+    in_order = in_order && (rb.pop() == expected);
+  }
+  producer.join();
+
+  CHECK(in_order);
+  CHECK(rb.dropped() == 0);
+  CHECK(rb.empty());
+}
+
+TEST_CASE("RingBuffer OverwriteOldest with a concurrent consumer") {
+  constexpr int count = 100000;
+  RingBuffer<std::shared_ptr<int>, DynamicCapacity, OverwriteOldest> rb(8);
+  std::atomic<bool> done{false};
+
+  std::thread producer([&] {
+    for (int i = 0; i < count; ++i) {
+      rb.push(std::make_shared<int>(i));
+    }
+    done = true;
+  });
+
+  int popped     = 0;
+  int last       = -1;
+  bool increases = true;
+  std::shared_ptr<int> sp;
+  while (!done || !rb.empty()) {
+    if (rb.try_pop(sp)) {
+      increases = increases && sp != nullptr && *sp > last;
+      last      = *sp;
+      ++popped;
+    }
+  }
+  producer.join();
+
+  CHECK(increases);
+  CHECK(last == count - 1);
+  CHECK(popped + rb.dropped() == count);
+}
+
+template <typename Wait>
+void check_wait_strategy() {
+  constexpr int count = 1000;
+  RingBuffer<int, PowerOfTwoCapacity, BlockWhenFull, Wait> rb(64);
+
+  std::thread producer([&rb] {
+    for (int i = 0; i < count; ++i) {
+      rb.push(i);
+    }
+  });
+
+  bool in_order = true;
+  for (int expected = 0; expected < count; ++expected) {
+    in_order = in_order && (rb.pop() == expected);
+  }
+  producer.join();
+
+  CHECK(in_order);
+  CHECK(rb.empty());
+}
+
+// only rings whose threads may park pay for notifying them
+static_assert(!kMayPark<BusySpin> && !kMayPark<BackoffSpin<>> && !kMayPark<SpinThenYield<>>);
+static_assert(kMayPark<SpinThenPark<>> && kMayPark<Park>);
+
+TEST_CASE("RingBuffer wait strategies") {
+  check_wait_strategy<BusySpin>();
+  check_wait_strategy<BackoffSpin<>>();
+  check_wait_strategy<SpinThenYield<10>>();
+  check_wait_strategy<SpinThenPark<10>>();
+  check_wait_strategy<Park>();
+}
+
+struct Counted {
+  static inline int alive = 0;
+
+  explicit Counted(int v) : value(v) { ++alive; }
+  Counted(Counted&& other) noexcept : value(other.value) { ++alive; }
+  Counted& operator=(Counted&&) = default;
+  ~Counted() { --alive; }
+
+  int value;
+};
+
+TEST_CASE("RingBuffer with move-only and non-default-constructible elements") {
+  RingBuffer<std::unique_ptr<int>> rb(4);
+  rb.push(std::make_unique<int>(1));
+  CHECK(rb.try_push(std::make_unique<int>(2)));
+
+  std::unique_ptr<int> out;
+  CHECK(rb.try_pop(out));
+  CHECK(*out == 1);
+  CHECK(*rb.pop() == 2);
+
+  {
+    RingBuffer<Counted, PowerOfTwoCapacity, OverwriteOldest> counted(2);
+    counted.push(Counted(1));
+    counted.push(Counted(2));
+    CHECK(Counted::alive == 2);
+
+    // overwriting destroys the oldest element right away
+    counted.push(Counted(3));
+    CHECK(Counted::alive == 2);
+
+    CHECK(counted.pop().value == 2);
+    CHECK(Counted::alive == 1);
+  }
+  // the ring destroys what is left in it
+  CHECK(Counted::alive == 0);
+
+  {
+    StaticRingBuffer<Counted, 4> fixed;
+    fixed.push(Counted(1));
+    fixed.push(Counted(2));
+    StaticRingBuffer<Counted, 4> moved(std::move(fixed));
+    CHECK(fixed.empty());
+    CHECK(Counted::alive == 2);
+    CHECK(moved.pop().value == 1);
+  }
+  CHECK(Counted::alive == 0);
+}
+
+// throws on the move of the element with value == throw_on
+struct MoveMayThrow {
+  static inline int alive    = 0;
+  static inline int throw_on = -1;
+
+  explicit MoveMayThrow(int v) : value(v) { ++alive; }
+  MoveMayThrow(MoveMayThrow&& other) noexcept(false) : value(other.value) {
+    if (value == throw_on) {
+      throw std::runtime_error("move failed");
+    }
+    ++alive;
+  }
+  ~MoveMayThrow() { --alive; }
+
+  int value;
+};
+
+static_assert(!std::is_nothrow_move_constructible_v<StaticRingBuffer<MoveMayThrow, 4>>);
+static_assert(std::is_nothrow_move_constructible_v<RingBuffer<MoveMayThrow>>);
+static_assert(std::is_nothrow_move_constructible_v<StaticRingBuffer<int, 4>>);
+
+TEST_CASE("StaticRingBuffer move that throws leaves the source intact") {
+  using Ring = StaticRingBuffer<MoveMayThrow, 4>;
+  {
+    Ring fixed;
+    for (int i = 0; i < 3; ++i) {
+      fixed.emplace(i);
+    }
+    MoveMayThrow::throw_on = 1;
+    CHECK_THROWS_AS(Ring(std::move(fixed)), std::runtime_error);
+    CHECK(MoveMayThrow::alive == 3);
+    CHECK(fixed.size() == 3);
+
+    MoveMayThrow::throw_on = -1;
+    Ring moved(std::move(fixed));
+    CHECK(fixed.empty());
+    CHECK(MoveMayThrow::alive == 3);
+    CHECK(moved.pop().value == 0);
+  }
+  CHECK(MoveMayThrow::alive == 0);
+}
+
+struct Level {
+  static inline int moves = 0;
+
+  Level(std::string n, int q) : name(std::move(n)), qty(q) {}
+  Level(Level&& other) noexcept : name(std::move(other.name)), qty(other.qty) { ++moves; }
+  Level& operator=(Level&&) = default;
+
+  std::string name;
+  int qty;
+};
+
+TEST_CASE("RingBuffer emplace constructs in the slot") {
+  RingBuffer<Level, DynamicCapacity, DropNewest> rb(2);
+  rb.emplace("bid", 1);
+  CHECK(rb.try_emplace(std::string("ask"), 2));
+  CHECK_FALSE(rb.try_emplace("mid", 3));
+  rb.emplace("mid", 3);
+  CHECK(rb.dropped() == 1);
+  CHECK(Level::moves == 0);
+
+  auto [name, qty] = rb.pop();
+  CHECK(name == "bid");
+  CHECK(qty == 1);
+  CHECK(rb.pop().name == "ask");
+}
+
+TEST_CASE("RingBuffer drain") {
+  RingBuffer<std::shared_ptr<int>, PowerOfTwoCapacity> rb(4);
+  auto sp = std::make_shared<int>(0);
+  for (int i = 0; i < 4; ++i) {
+    rb.push(sp);
+  }
+  rb.try_pop(sp);
+  rb.push(std::make_shared<int>(4));  // the batch wraps around
+
+  int seen = 0;
+  CHECK(rb.drain([&](std::shared_ptr<int>& item) { seen += item == sp; }, 2) == 2);
+  CHECK(seen == 2);
+  CHECK(sp.use_count() == 2);
+
+  std::vector<int> values;
+  CHECK(rb.drain([&](std::shared_ptr<int>& item) { values.push_back(*item); }) == 2);
+  CHECK(values == std::vector<int>{0, 4});
+  CHECK(sp.use_count() == 1);
+  CHECK(rb.drain([](std::shared_ptr<int>&) {}) == 0);
+}
+
+TEST_CASE("RingBuffer drain consumes the elements before a throw") {
+  auto check = [](auto rb) {
+    for (int i = 0; i < 4; ++i) {
+      rb.push(std::make_shared<int>(i));
+    }
+    int calls = 0;
+    CHECK_THROWS(rb.drain([&](std::shared_ptr<int>& item) {
+      ++calls;
+      if (*item == 2) {
+        throw std::runtime_error("stop");
+      }
+    }));
+    CHECK(calls == 3);
+    CHECK(rb.size() == 2);
+    // 2 is still queued and every element is alive exactly once
+    CHECK(*rb.pop() == 2);
+    std::vector<int> rest;
+    CHECK(rb.drain([&](std::shared_ptr<int>& item) { rest.push_back(*item); }) == 1);
+    CHECK(rest == std::vector<int>{3});
+  };
+  check(RingBuffer<std::shared_ptr<int>>(4));
+  check(RingBuffer<std::shared_ptr<int>, DynamicCapacity, OverwriteOldest>(4));
+}
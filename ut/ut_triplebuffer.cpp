@@ -0,0 +1,102 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+#include "MsgQueue.hpp"
+#include "backend/TripleBuffer.hpp"
+
+#include <memory>
+#include <thread>
+#include <type_traits>
+
+TEST_CASE("TripleBuffer keeps only the latest value") {
+  TripleBuffer<int> tb;
+  CHECK(tb.empty());
+  CHECK_FALSE(tb.has_new());
+  CHECK(tb.peek() == nullptr);
+
+  int val = 0;
+  CHECK_FALSE(tb.try_pop(val));
+
+  tb.push(1);
+  tb.push(2);
+  CHECK(tb.try_push(3));
+  CHECK(tb.has_new());
+  CHECK(tb.size() == 1);
+  CHECK(tb.conflated() == 2);
+
+  // peek takes the value over but leaves it there
+  REQUIRE(tb.peek() != nullptr);
+  CHECK(*tb.peek() == 3);
+  CHECK_FALSE(tb.has_new());
+  CHECK(tb.size() == 1);
+  CHECK_FALSE(tb.empty());
+  CHECK(tb.try_pop(val));
+  CHECK(val == 3);
+  CHECK(tb.empty());
+  CHECK_FALSE(tb.try_pop(val));
+
+  tb.emplace(4);
+  CHECK(tb.pop() == 4);
+  CHECK(tb.size() == 0);
+  CHECK(tb.conflated() == 2);
+}
+
+TEST_CASE("TripleBuffer with move-only values") {
+  TripleBuffer<std::unique_ptr<int>> tb;
+  tb.push(std::make_unique<int>(1));
+  tb.push(std::make_unique<int>(2));
+  auto moved = std::move(tb);
+  CHECK(*moved.pop() == 2);
+  CHECK(moved.empty());
+}
+
+struct MoveMayThrow {
+  MoveMayThrow() = default;
+  MoveMayThrow(MoveMayThrow&&) noexcept(false) {}
+  MoveMayThrow& operator=(MoveMayThrow&&) noexcept(false) { return *this; }
+};
+
+static_assert(std::is_nothrow_move_constructible_v<TripleBuffer<std::unique_ptr<int>>>);
+static_assert(!std::is_nothrow_move_constructible_v<TripleBuffer<MoveMayThrow>>);
+static_assert(!std::is_nothrow_move_assignable_v<TripleBuffer<MoveMayThrow>>);
+
+TEST_CASE("TripleBuffer consumer never sees a torn or older value") {
+  struct Snapshot {
+    long seq;
+    long check;
+  };
+  constexpr long count = 200000;
+  TripleBuffer<Snapshot, SpinThenPark<10>> tb;
+
+  std::thread producer([&tb] {
+    for (long i = 1; i <= count; ++i) {
+      tb.push(Snapshot{i, -i});
+    }
+  });
+
+  long last  = 0;
+  bool valid = true;
+  while (last != count) {
+    Snapshot s = tb.pop();
+    valid      = valid && s.seq > last && s.check == -s.seq;
+    last       = s.seq;
+  }
+  producer.join();
+
+  CHECK(valid);
+  CHECK(tb.empty());
+}
+
+TEST_CASE("MsgQueue with TripleBuffer keeps the latest message") {
+  static_assert(BoundedBackend<TripleBuffer<int>>);
+
+  MsgQueue mq(TripleBuffer<int>{});
+  CHECK(mq.capacity() == 1);
+  mq.enqueue(1);
+  mq.enqueue(2);
+  CHECK(mq.size() == 1);
+
+  int val = 0;
+  CHECK(mq.dequeue(val));
+  CHECK(val == 2);
+  CHECK_FALSE(mq.dequeue(val));
+}
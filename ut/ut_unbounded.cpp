@@ -0,0 +1,111 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+#include "MsgQueue.hpp"
+#include "backend/UnboundedRing.hpp"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+TEST_CASE("UnboundedRingBuffer grows and recycles chunks") {
+  UnboundedRingBuffer<int, 4> rb;
+  CHECK(rb.empty());
+  CHECK(rb.stats().allocations == 1);
+
+  // a burst never drops, it allocates more chunks
+  for (int i = 0; i < 20; ++i) {
+    CHECK(rb.try_push(i));
+  }
+  CHECK(rb.size() == 20);
+  CHECK(rb.stats().chunks == 5);
+  CHECK(rb.stats().peak_chunks == 5);
+
+  int val       = 0;
+  bool in_order = true;
+  for (int i = 0; i < 20; ++i) {
+    in_order = in_order && rb.try_pop(val) && val == i;
+  }
+  CHECK(in_order);
+  CHECK_FALSE(rb.try_pop(val));
+  CHECK(rb.empty());
+
+  // steady state runs on the cached chunks
+  size_t allocations = rb.stats().allocations;
+  for (int i = 0; i < 1000; ++i) {
+    rb.push(i);
+    rb.emplace(i + 1);
+    CHECK(rb.pop() == i);
+    CHECK(rb.pop() == i + 1);
+  }
+  CHECK(rb.stats().allocations == allocations);
+  CHECK(rb.stats().peak_chunks == 5);
+  CHECK(rb.stats().peak_bytes >= 5 * 4 * sizeof(int));
+}
+
+TEST_CASE("UnboundedRingBuffer frees chunks beyond the cache") {
+  UnboundedRingBuffer<int, 2> rb;
+  for (int i = 0; i < 40; ++i) {
+    rb.push(i);
+  }
+  for (int i = 0; i < 40; ++i) {
+    rb.pop();
+  }
+  CHECK(rb.stats().peak_chunks == 20);
+  CHECK(rb.stats().chunks < 20);
+}
+
+TEST_CASE("UnboundedRingBuffer with move-only elements") {
+  auto sp = std::make_shared<int>(1);
+  {
+    UnboundedRingBuffer<std::unique_ptr<std::shared_ptr<int>>, 2> rb;
+    for (int i = 0; i < 5; ++i) {
+      rb.push(std::make_unique<std::shared_ptr<int>>(sp));
+    }
+    CHECK(sp.use_count() == 6);
+    CHECK(*rb.pop() == sp);
+    CHECK(sp.use_count() == 5);
+
+    auto moved = std::move(rb);
+    CHECK(moved.size() == 4);
+  }
+  // the ring destroys what is left in it
+  CHECK(sp.use_count() == 1);
+}
+
+TEST_CASE("UnboundedRingBuffer producer never waits") {
+  constexpr int count = 200000;
+  UnboundedRingBuffer<int, 64, SpinThenPark<10>> rb;
+
+  std::thread producer([&rb] {
+    for (int i = 0; i < count; ++i) {
+      rb.push(i);
+    }
+  });
+
+  bool in_order = true;
+  for (int i = 0; i < count; ++i) {
+    in_order = in_order && rb.pop() == i;
+  }
+  producer.join();
+
+  CHECK(in_order);
+  CHECK(rb.empty());
+}
+
+TEST_CASE("MsgQueue with UnboundedRingBuffer grows past a chunk") {
+  static_assert(!BoundedBackend<UnboundedRingBuffer<int>>);
+
+  MsgQueue mq(UnboundedRingBuffer<int, 16>{});
+  for (int i = 0; i < 100; ++i) {
+    mq.enqueue(i);
+  }
+  CHECK(mq.size() == 100);
+
+  int val       = 0;
+  bool in_order = true;
+  for (int i = 0; i < 100; ++i) {
+    in_order = in_order && mq.dequeue(val) && val == i;
+  }
+  CHECK(in_order);
+  CHECK(mq.empty());
+}